@@ -0,0 +1,115 @@
+//!
+//! Parser throughput over generated corpora.
+//!     cargo bench --bench parse
+//! Corpus sizes grow 16x per step from 1 KB up to VTC_BENCH_MAX (bytes, accepts K/M/G suffixes).
+//! Each phase is timed separately on fresh inputs; setup is excluded from timings.
+//!
+
+use std::env;
+use std::fs;
+use std::hint::black_box;
+use std::time::{Duration, Instant};
+use vtc::corpus;
+use vtc::serializer::compiled::{self, SourceId};
+use vtc::serializer::parser::RParser;
+use vtc::serializer::reclaim;
+use vtc::serializer::stream;
+use vtc::serializer::token::Tokens;
+
+const SEED: u64 = 0x5eed;
+const MIN_TIME: Duration = Duration::from_millis(500);
+const MAX_ITERS: u32 = 1000;
+/// Bounds wall time, setup included, for phases whose setup dwarfs the routine
+const MAX_WALL: Duration = Duration::from_secs(5);
+const DEFAULT_MAX: usize = 4 << 20;
+
+/// Run `setup` + `routine` until MIN_TIME of routine time accumulates; returns mean ns/op
+fn measure<S, T, R>(mut setup: S, mut routine: R) -> f64
+	where S: FnMut() -> T, R: FnMut(T) {
+	let wall = Instant::now();
+	let mut total = Duration::ZERO;
+	let mut iters = 0;
+	while iters == 0 || (total < MIN_TIME && iters < MAX_ITERS && wall.elapsed() < MAX_WALL) {
+		let input = setup();
+		let start = Instant::now();
+		routine(input);
+		total += start.elapsed();
+		iters += 1;
+	}
+	total.as_nanos() as f64 / iters as f64
+}
+
+fn report(phase: &str, bytes: usize, tokens: usize, ns: f64) {
+	let secs = ns / 1e9;
+	println!("{:>10} {:>12} {:>14.0} {:>10.2} {:>14.0}",
+		size_label(bytes), phase, ns, bytes as f64 / secs / 1e6, tokens as f64 / secs);
+}
+
+fn size_label(bytes: usize) -> String {
+	match bytes {
+		b if b >= 1 << 30 => format!("{}G", b >> 30),
+		b if b >= 1 << 20 => format!("{}M", b >> 20),
+		b => format!("{}K", b >> 10),
+	}
+}
+
+fn tokenized(path: &str) -> Tokens {
+	let mut tokens = Tokens::new(path).unwrap();
+	tokens.tokenize().unwrap();
+	tokens
+}
+
+fn parsed(path: &str) -> RParser {
+	let mut parser = RParser::new(tokenized(path));
+	parser.generate_ast();
+	parser
+}
+
+fn main() {
+	let max = env::var("VTC_BENCH_MAX").ok().and_then(|v| corpus::parse_size(&v)).unwrap_or(DEFAULT_MAX);
+	let path = env::temp_dir().join(format!("vtc-bench-{}.vtc", std::process::id()));
+	let path = path.to_str().unwrap();
+
+	println!("{:>10} {:>12} {:>14} {:>10} {:>14}", "size", "phase", "ns/op", "MB/s", "tokens/s");
+	let mut size = 1 << 10;
+	while size <= max {
+		let data = corpus::generate(size, SEED);
+		fs::write(path, &data).unwrap();
+		let bytes = data.len();
+		let token_count = tokenized(path).len();
+
+		let ns = measure(|| (), |_| { black_box(Tokens::new(path).unwrap()); });
+		report("read", bytes, 0, ns);
+
+		let ns = measure(|| Tokens::new(path).unwrap(), |mut t| { t.tokenize().unwrap(); black_box(t); });
+		report("tokenize", bytes, token_count, ns);
+
+		let ns = measure(|| RParser::new(tokenized(path)), |mut p| { p.generate_ast(); black_box(p); });
+		report("parse", bytes, token_count, ns);
+
+		// Tokenize + parse with the two overlapped on separate threads
+		let ns = measure(|| Tokens::new(path).unwrap(), |t| { black_box(stream::parse(t).unwrap()); });
+		report("overlapped", bytes, token_count, ns);
+
+		let ns = measure(|| parsed(path), |mut p| { black_box(p.resolve()); });
+		report("resolve", bytes, token_count, ns);
+
+		// Freeing a document in place, and handing it to the reclaimer thread instead
+		let ns = measure(|| parsed(path), |p| drop(p));
+		report("drop", bytes, token_count, ns);
+		let ns = measure(|| { reclaim::flush(); parsed(path) }, |p| reclaim::retire(p));
+		report("retire", bytes, token_count, ns);
+
+		let mut resolved = parsed(path);
+		resolved.resolve();
+		let ns = measure(|| (), |_| { black_box(compiled::encode(&resolved, SourceId::default(), &[])); });
+		report("compile", bytes, token_count, ns);
+
+		let encoded = compiled::encode(&resolved, SourceId::default(), &[]);
+		let ns = measure(|| (), |_| { black_box(compiled::decode(&encoded, SourceId::default(), &[]).unwrap()); });
+		report("load", bytes, token_count, ns);
+
+		size <<= 4;
+	}
+	fs::remove_file(path).ok();
+}
@@ -0,0 +1,75 @@
+/*
+ * vtc
+ * C API for loading and querying vtc documents. Mirrors src/ffi.rs.
+ *
+ * Every view (vtc_str, vtc_list) points into the loaded document and stays
+ * valid until vtc_close() is called; nothing is copied out.
+ */
+#ifndef VTC_H
+#define VTC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VTC_OK             0
+#define VTC_NOT_FOUND     -1
+#define VTC_TYPE_MISMATCH -2
+#define VTC_OUT_OF_RANGE  -3
+
+typedef enum vtc_kind {
+	VTC_INT64   = 0,
+	VTC_FLOAT64 = 1,
+	VTC_STR     = 2,
+	VTC_REF     = 3,
+	VTC_PTR     = 4,
+} vtc_kind;
+
+/* Not NUL-terminated */
+typedef struct vtc_str {
+	const char *ptr;
+	size_t len;
+} vtc_str;
+
+/* Values of one variable; `items` is opaque */
+typedef struct vtc_list {
+	const void *items;
+	size_t len;
+} vtc_list;
+
+typedef struct vtc_doc vtc_doc;
+
+/* Open, parse and resolve `path`. Returns NULL on failure */
+vtc_doc *vtc_open(const char *path);
+/* Parse and resolve `len` bytes of UTF-8 text; the buffer is copied. Returns NULL on failure */
+vtc_doc *vtc_load(const char *data, size_t len);
+/* Why the last open/load on this thread returned NULL; VTC_NOT_FOUND if it succeeded.
+ * Valid until the next open/load on this thread */
+int vtc_last_error(vtc_str *out);
+void vtc_close(vtc_doc *doc);
+
+size_t vtc_container_count(const vtc_doc *doc);
+int vtc_container_name(const vtc_doc *doc, size_t idx, vtc_str *out);
+
+/* Query "container.variable" */
+int vtc_query(const vtc_doc *doc, const char *path, size_t path_len, vtc_list *out);
+
+/* Returns a vtc_kind, or VTC_OUT_OF_RANGE */
+int vtc_value_kind(const vtc_list *list, size_t idx);
+int vtc_value_str(const vtc_list *list, size_t idx, vtc_str *out);
+int vtc_value_i64(const vtc_list *list, size_t idx, int64_t *out);
+int vtc_value_f64(const vtc_list *list, size_t idx, double *out);
+/* `variable` is -1 when the whole container is selected */
+int vtc_value_target(const vtc_list *list, size_t idx, uint32_t *container, int32_t *variable);
+/* Index range of a reference/pointer: `len` is 0 for the whole target, 1 for a single
+ * index, 2 for an inclusive from..to. VTC_TYPE_MISMATCH for plain values */
+int vtc_value_range(const vtc_list *list, size_t idx, const uint16_t **range, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VTC_H */
@@ -0,0 +1,277 @@
+//! Counting allocator.
+//! Install it in a binary and call `enable_counting` to make allocation counts and
+//! peak memory observable:
+//! ```ignore
+//! #[global_allocator]
+//! static ALLOC: vtc::alloc::CountingAlloc = vtc::alloc::CountingAlloc;
+//!
+//! vtc::alloc::enable_counting();
+//! ```
+//! Until then it forwards to the system allocator and every snapshot reads as zero.
+//!
+//! `one_shot` turns it into a bump allocator for runs that parse, check and exit.
+
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::cell::Cell;
+use std::ptr;
+use std::sync::atomic::{AtomicBool, AtomicIsize, AtomicUsize, Ordering::Relaxed};
+
+pub struct CountingAlloc;
+
+/// Set by `enable_counting`; the counters below stay untouched until then
+static COUNTING: AtomicBool = AtomicBool::new(false);
+static ALLOCS: AtomicUsize = AtomicUsize::new(0);
+static ALLOC_BYTES: AtomicUsize = AtomicUsize::new(0);
+/// Signed: blocks allocated before counting started may be freed after
+static CURRENT: AtomicIsize = AtomicIsize::new(0);
+static PEAK: AtomicIsize = AtomicIsize::new(0);
+
+/// Set by `one_shot` and never cleared: bump memory must never reach `System.dealloc`
+static BUMP: AtomicBool = AtomicBool::new(false);
+/// Bump chunk size; larger requests get a block of their own
+const CHUNK: usize = 4 << 20;
+const CHUNK_ALIGN: usize = 4096;
+
+thread_local! {
+	/// Free space left in this thread's chunk as (next, end) addresses. Const-initialized
+	/// and without a destructor, so touching it from the allocator never allocates
+	static SPACE: Cell<(usize, usize)> = const { Cell::new((0, 0)) };
+	/// Set while `region` copies results out; allocations then come from the system
+	static ESCAPE: Cell<bool> = const { Cell::new(false) };
+}
+
+unsafe impl GlobalAlloc for CountingAlloc {
+	#[inline]
+	unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+		let ptr = match BUMP.load(Relaxed) {
+			true => bump(layout),
+			false => System.alloc(layout),
+		};
+		if !ptr.is_null() { grow(layout.size()); }
+		ptr
+	}
+
+	#[inline]
+	unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+		let ptr = match BUMP.load(Relaxed) {
+			true => {
+				let ptr = bump(layout);
+				if !ptr.is_null() { ptr::write_bytes(ptr, 0, layout.size()); }
+				ptr
+			},
+			false => System.alloc_zeroed(layout),
+		};
+		if !ptr.is_null() { grow(layout.size()); }
+		ptr
+	}
+
+	#[inline]
+	unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+		if !BUMP.load(Relaxed) { System.dealloc(ptr, layout); }
+		if COUNTING.load(Relaxed) { CURRENT.fetch_sub(layout.size() as isize, Relaxed); }
+	}
+
+	#[inline]
+	unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+		let new_ptr = match BUMP.load(Relaxed) {
+			true => bump_realloc(ptr, layout, new_size),
+			false => System.realloc(ptr, layout, new_size),
+		};
+		if !new_ptr.is_null() && COUNTING.load(Relaxed) {
+			CURRENT.fetch_sub(layout.size() as isize, Relaxed);
+			grow(new_size);
+		}
+		new_ptr
+	}
+}
+
+#[inline]
+fn align_up(addr: usize, align: usize) -> usize {
+	(addr + align - 1) & !(align - 1)
+}
+
+/// Allocate from this thread's chunk, starting a new chunk when it is full
+#[inline]
+unsafe fn bump(layout: Layout) -> *mut u8 {
+	if layout.size() > CHUNK / 8 || layout.align() > CHUNK_ALIGN { return System.alloc(layout) }
+	if ESCAPE.try_with(Cell::get).unwrap_or(true) { return System.alloc(layout) }
+	SPACE.try_with(|space| {
+		let (next, end) = space.get();
+		let start = align_up(next, layout.align());
+		if next != 0 && start + layout.size() <= end {
+			space.set((start + layout.size(), end));
+			return start as *mut u8
+		}
+		// The rest of the old chunk is abandoned
+		let chunk = System.alloc(Layout::from_size_align_unchecked(CHUNK, CHUNK_ALIGN));
+		if chunk.is_null() { return chunk }
+		space.set((chunk as usize + layout.size(), chunk as usize + CHUNK));
+		chunk
+	}).unwrap_or_else(|_| System.alloc(layout))
+}
+
+/// Grow or shrink in place when `ptr` is the thread's latest bump allocation, otherwise copy
+#[inline]
+unsafe fn bump_realloc(ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+	let in_place = SPACE.try_with(|space| {
+		let (next, end) = space.get();
+		// Chunk blocks stay small, so any block over CHUNK / 8 is known to be the system's
+		let fits = ptr as usize + layout.size() == next && ptr as usize + new_size <= end && new_size <= CHUNK / 8;
+		if fits { space.set((ptr as usize + new_size, end)); }
+		fits
+	}).unwrap_or(false);
+	if in_place { return ptr }
+	// Blocks this large never come from a chunk, so the system can resize them
+	let large = |size: usize| size > CHUNK / 8 || layout.align() > CHUNK_ALIGN;
+	if large(layout.size()) && large(new_size) { return System.realloc(ptr, layout, new_size) }
+
+	let new_ptr = bump(Layout::from_size_align_unchecked(new_size, layout.align()));
+	if !new_ptr.is_null() { ptr::copy_nonoverlapping(ptr, new_ptr, layout.size().min(new_size)); }
+	new_ptr
+}
+
+///
+/// Switch CountingAlloc to one-shot mode for the rest of the process: allocations are
+/// bumped out of per-thread chunks and frees do nothing, so memory only goes back when
+/// the process exits. For runs that parse, check and exit. Has no effect unless
+/// CountingAlloc is the global allocator
+///
+pub fn one_shot() {
+	BUMP.store(true, Relaxed);
+}
+
+/// True once `one_shot` has been called
+pub fn is_one_shot() -> bool {
+	BUMP.load(Relaxed)
+}
+
+///
+/// Run `work`, copy what outlives it out of its result with `keep`, then release everything
+/// this thread bump-allocated during `work` at once, so a long one-shot run reuses warm
+/// memory instead of touching fresh pages. Outside one-shot mode (and when tracing, whose
+/// spans outlive the work) this is just `keep(&work())`.
+///
+/// # Safety
+/// In one-shot mode the memory `work` allocated on this thread is handed out again by
+/// later allocations, so once `region` returns none of it may be reachable:
+/// * `work` must not store anything it allocates where it outlives the call: in statics,
+///   thread locals, caches (`include`, `pool`) or channels, or on other threads. This
+///   includes state initialized lazily on first use, such as a `OnceLock` or the stdout
+///   buffer; touch such state before the region, not in it
+/// * `keep` must return a deep copy. It runs with bump allocation off, so what it
+///   allocates is the system's, but an `Arc`, raw pointer or index into the value
+///   would still lead back into the region
+/// * The value is forgotten, not dropped: `T` must not rely on its destructor
+///   (locks, files, joined threads) for correctness
+/// * Regions on one thread may nest inside `work`, but not inside `keep`
+///
+/// Allocations made on other threads, and blocks too large for a chunk, are not
+/// released; a panic in `work` or `keep` leaks the region's memory but is sound
+///
+pub(crate) unsafe fn region<T, R>(work: impl FnOnce() -> T, keep: impl FnOnce(&T) -> R) -> R {
+	if !is_one_shot() || crate::trace::ENABLED { return keep(&work()) }
+
+	let (mark, mark_end) = SPACE.try_with(Cell::get).unwrap_or((0, 0));
+	let value = work();
+	let _ = ESCAPE.try_with(|escape| escape.set(true));
+	let kept = keep(&value);
+	let _ = ESCAPE.try_with(|escape| escape.set(false));
+	std::mem::forget(value);
+
+	let _ = SPACE.try_with(|space| {
+		let (_, end) = space.get();
+		match end == mark_end {
+			true => space.set((mark, end)),
+			// Chunks filled during `work` are abandoned; the latest one is reused from its start
+			false => space.set((end - CHUNK, end)),
+		}
+	});
+	kept
+}
+
+///
+/// `region` for tests/region.rs, which cannot reach crate items. Not part of the API.
+///
+/// # Safety
+/// As for `region`
+///
+#[doc(hidden)]
+pub unsafe fn test_region<T, R>(work: impl FnOnce() -> T, keep: impl FnOnce(&T) -> R) -> R {
+	region(work, keep)
+}
+
+///
+/// Drop `value`; in one-shot mode forget it instead, since freeing does nothing
+/// there and walking its destructors is pure overhead
+///
+#[inline]
+pub fn discard<T>(value: T) {
+	match is_one_shot() {
+		true => std::mem::forget(value),
+		false => drop(value),
+	}
+}
+
+#[inline]
+fn grow(size: usize) {
+	if !COUNTING.load(Relaxed) { return }
+	ALLOCS.fetch_add(1, Relaxed);
+	ALLOC_BYTES.fetch_add(size, Relaxed);
+	let current = CURRENT.fetch_add(size as isize, Relaxed) + size as isize;
+	PEAK.fetch_max(current, Relaxed);
+}
+
+///
+/// Start counting allocations. Until this is called CountingAlloc only forwards to the
+/// allocator underneath, so binaries that install it pay for counting only when they
+/// report it. Bytes live before the call are not part of `current`
+///
+pub fn enable_counting() {
+	COUNTING.store(true, Relaxed);
+}
+
+///
+/// Allocation counters at one point in time
+/// * allocs: allocations and reallocations since start
+/// * bytes: bytes requested by them
+/// * current: bytes live now, allocated since counting started
+/// * peak: highest `current` since counting started or the last `reset_peak`
+///
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct AllocSnapshot {
+	pub allocs: usize,
+	pub bytes: usize,
+	pub current: usize,
+	pub peak: usize,
+}
+
+impl AllocSnapshot {
+	/// Counters accumulated since `earlier`; `current` and `peak` are kept as-is
+	pub fn since(&self, earlier: &AllocSnapshot) -> AllocSnapshot {
+		AllocSnapshot {
+			allocs: self.allocs - earlier.allocs,
+			bytes: self.bytes - earlier.bytes,
+			current: self.current,
+			peak: self.peak,
+		}
+	}
+}
+
+pub fn snapshot() -> AllocSnapshot {
+	AllocSnapshot {
+		allocs: ALLOCS.load(Relaxed),
+		bytes: ALLOC_BYTES.load(Relaxed),
+		current: CURRENT.load(Relaxed).max(0) as usize,
+		peak: PEAK.load(Relaxed).max(0) as usize,
+	}
+}
+
+/// Restart peak tracking from the bytes live now
+pub fn reset_peak() {
+	PEAK.store(CURRENT.load(Relaxed), Relaxed);
+}
+
+/// True when CountingAlloc is the global allocator and counting has been enabled
+pub fn installed() -> bool {
+	COUNTING.load(Relaxed) && ALLOCS.load(Relaxed) > 0
+}
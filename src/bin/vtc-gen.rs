@@ -0,0 +1,81 @@
+//!
+//! Emit a synthetic .vtc document with a controlled shape:
+//!     vtc-gen --size 64M --refs 0.4 --chain-depth 3 -o big.vtc
+//!
+
+use std::fs::File;
+use std::io::{self, BufWriter, Write};
+use clap::Parser;
+use vtc::corpus::{parse_size, Shape};
+
+#[derive(Parser, Debug)]
+#[clap(author, version, about, long_about = None)]
+struct Args {
+	/// Number of containers
+	#[clap(long, value_parser)]
+	containers: Option<usize>,
+
+	/// Approximate output size (K/M/G suffixes); overrides --containers
+	#[clap(long, value_parser)]
+	size: Option<String>,
+
+	/// Variables per container, pointer chain included; 0 writes empty containers
+	#[clap(long, value_parser)]
+	vars: Option<usize>,
+
+	/// Values per list; 0 writes empty lists
+	#[clap(long, value_parser)]
+	list_len: Option<usize>,
+
+	/// Share of plain values that are numeric (0..1)
+	#[clap(long, value_parser)]
+	numeric: Option<f64>,
+
+	/// Share of values that reference earlier variables (0..1)
+	#[clap(long, value_parser)]
+	refs: Option<f64>,
+
+	/// Length of the pointer chain closing each container
+	#[clap(long, value_parser)]
+	chain_depth: Option<usize>,
+
+	/// Indices per reference/pointer range; 0 references whole lists
+	#[clap(long, value_parser)]
+	range: Option<usize>,
+
+	/// Comment lines per variable
+	#[clap(long, value_parser)]
+	comments: Option<f64>,
+
+	#[clap(long, value_parser, default_value_t = 1)]
+	seed: u64,
+
+	/// Output file; defaults to stdout
+	#[clap(short, long, value_parser)]
+	output: Option<String>,
+}
+
+fn main() -> io::Result<()> {
+	let args = Args::parse();
+	let mut shape = Shape::default();
+	if let Some(v) = args.containers { shape.containers = v; }
+	if let Some(v) = args.vars { shape.vars = v; }
+	if let Some(v) = args.list_len { shape.list_len = v; }
+	if let Some(v) = args.numeric { shape.numeric = v; }
+	if let Some(v) = args.refs { shape.refs = v; }
+	if let Some(v) = args.chain_depth { shape.chain_depth = v; }
+	if let Some(v) = args.range { shape.range = v; }
+	if let Some(v) = args.comments { shape.comments = v; }
+	if let Some(size) = &args.size {
+		let bytes = parse_size(size).ok_or_else(|| io::Error::new(io::ErrorKind::InvalidInput, format!("bad size '{}'", size)))?;
+		shape = shape.sized(bytes);
+	}
+
+	let out: Box<dyn Write> = match &args.output {
+		Some(path) => Box::new(File::create(path)?),
+		None => Box::new(io::stdout().lock()),
+	};
+	let mut out = BufWriter::new(out);
+	shape.write(args.seed, &mut out)?;
+	out.flush()
+}
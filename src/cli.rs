@@ -1,9 +1,71 @@
 
-use clap::Parser;
+use clap::{Parser, Subcommand};
 
 #[derive(Parser, Debug)]
-#[clap(author, version, about, long_about = None)]
+#[clap(author, version, about, long_about = None, subcommand_precedence_over_arg = true)]
 pub struct Args {
+	/// Document to load, `-` for stdin; may be repeated
 	#[clap(short, long, value_parser)]
-	pub filename: String,
+	pub filename: Vec<String>,
+
+	/// More files, directories or globs. Several inputs are checked in parallel;
+	/// the exit status is non-zero if any of them fails
+	#[clap(value_parser)]
+	pub paths: Vec<String>,
+
+	/// Worker threads for checking several files; defaults to the number of CPUs
+	#[clap(short, long, value_parser)]
+	pub jobs: Option<usize>,
+
+	/// Active profile; sections tagged with other `%%profile` names are skipped
+	#[clap(short, long, value_parser)]
+	pub profile: Vec<String>,
+
+	/// Cache compiled documents in this directory, keyed by content hash
+	#[clap(long, value_parser)]
+	pub cache_dir: Option<String>,
+
+	/// Print per-phase timings, allocations and document counters to stderr
+	#[clap(long, value_parser)]
+	pub stats: bool,
+
+	/// Tokenize on a separate thread, overlapping lexing with parsing. Single files only;
+	/// cannot be combined with --stats, --explain or --cache-dir
+	#[clap(long, value_parser, conflicts_with_all = &["stats", "explain", "cache_dir"])]
+	pub overlap: bool,
+
+	/// Never free memory: allocate from bump arenas and skip destructors. Faster for
+	/// runs that parse, check and exit
+	#[clap(long, value_parser)]
+	pub one_shot: bool,
+
+	/// Attribute parse/resolve time and memory to containers and variables; print the top N
+	#[clap(long, value_parser)]
+	pub explain: Option<usize>,
+
+	/// Write a Chrome trace-event JSON timeline of the run to this file
+	#[cfg(feature = "trace")]
+	#[clap(long, value_parser)]
+	pub trace: Option<String>,
+
+	#[clap(subcommand)]
+	pub command: Option<Command>,
+}
+
+#[derive(Subcommand, Debug)]
+pub enum Command {
+	/// Generate source code with the parsed file embedded as constant data
+	Codegen {
+		/// Target language: cpp | rust
+		#[clap(long, value_parser, default_value = "cpp")]
+		lang: String,
+
+		/// C++ namespace or Rust static name
+		#[clap(long, value_parser)]
+		name: Option<String>,
+
+		/// Output file; defaults to stdout
+		#[clap(short, long, value_parser)]
+		output: Option<String>,
+	},
 }
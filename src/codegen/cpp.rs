@@ -0,0 +1,230 @@
+//! C++17 header generator.
+//! Emits the parsed document as `constexpr` tables:
+//! * per-type value pools (`ints`, `floats`, `strs`, `refs`) referenced by offset/length
+//! * `items` for lists that mix value types
+//! * `vars`/`containers` describing the document
+//! * a perfect hash (`phf_seeds`/`phf_slots`) so `find("container.variable")`
+//!   can be constant-folded by the compiler
+//! References and pointers are emitted as resolved container/variable indices.
+
+use std::collections::HashMap;
+use std::fmt::Write as FmtWrite;
+use crate::codegen::phf::{self, Phf};
+use crate::serializer::access::hash_parts;
+use crate::serializer::parser::{ListType, RParser, VarType};
+use crate::serializer::types::{Types, ValType};
+
+const PRELUDE: &str = r#"enum class kind : std::uint8_t { int64, float64, str, ref, mixed, empty };
+
+/// Resolved reference. `variable` is -1 when the whole container is selected,
+/// `container` is -1 when the reference could not be resolved
+struct ref {
+	std::int32_t container;
+	std::int32_t variable;
+	std::uint8_t range_len;
+	std::uint16_t range[2];
+};
+
+/// Element of a mixed list: pool `type` at `index`
+struct item {
+	kind type;
+	std::uint32_t index;
+};
+
+/// `offset`/`length` index the pool selected by `type`
+struct var {
+	std::uint64_t hash;
+	std::uint32_t container;
+	std::string_view name;
+	kind type;
+	std::uint32_t offset;
+	std::uint32_t length;
+	std::string_view empty_type;
+};
+
+struct container {
+	std::string_view name;
+	std::uint32_t first_var;
+	std::uint32_t var_count;
+};
+"#;
+
+const LOOKUP: &str = r#"constexpr std::uint64_t fnv1a(std::string_view path) noexcept {
+	std::uint64_t hash = 0xcbf29ce484222325ull;
+	for (char c : path) {
+		hash ^= static_cast<std::uint8_t>(c);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+constexpr std::uint64_t phf_mix(std::uint64_t hash, std::uint32_t seed) noexcept {
+	std::uint64_t x = hash ^ (static_cast<std::uint64_t>(seed) * 0x9e3779b97f4a7c15ull);
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdull;
+	x ^= x >> 33;
+	return x;
+}
+
+/// Look up "container.variable"; nullptr when absent.
+/// The names are compared as well, so a path whose hash collides is not found
+constexpr const var* find(std::string_view path) noexcept {
+	const std::uint64_t hash = fnv1a(path);
+	const std::uint32_t seed = phf_seeds[(hash >> 32) % phf_seeds.size()];
+	const std::uint32_t slot = phf_slots[phf_mix(hash, seed) & (phf_slots.size() - 1)];
+	if (slot == 0xffffffffu || vars[slot].hash != hash) { return nullptr; }
+	const std::string_view c_name = containers[vars[slot].container].name;
+	const std::string_view v_name = vars[slot].name;
+	if (path.size() != c_name.size() + 1 + v_name.size() || path.substr(0, c_name.size()) != c_name
+		|| path[c_name.size()] != '.' || path.substr(c_name.size() + 1) != v_name) {
+		return nullptr;
+	}
+	return &vars[slot];
+}
+"#;
+
+/// Pools shared by every list in the document
+#[derive(Default)]
+struct Pools {
+	ints: Vec<String>,
+	floats: Vec<String>,
+	strs: Vec<String>,
+	refs: Vec<String>,
+	items: Vec<String>,
+}
+
+impl Pools {
+	/// Push one value into its pool, returning (kind, index)
+	fn push(&mut self, value: &ListType) -> (&'static str, u32) {
+		match (&value.store_type, &value.val_type) {
+			(ValType::Value, Types::I64) if value.value.parse::<i64>().is_ok() => {
+				let v: i64 = value.value.parse().unwrap();
+				// -2^63 has no literal form in C++
+				let lit = if v == i64::MIN { "(-9223372036854775807LL - 1)".to_string() } else { format!("{}LL", v) };
+				self.ints.push(lit);
+				("int64", self.ints.len() as u32 - 1)
+			}
+			(ValType::Value, Types::Float64) if value.value.parse::<f64>().is_ok() => {
+				self.floats.push(format!("{:?}", value.value.parse::<f64>().unwrap()));
+				("float64", self.floats.len() as u32 - 1)
+			}
+			(ValType::Value, _) => {
+				self.strs.push(string_view(&value.value));
+				("str", self.strs.len() as u32 - 1)
+			}
+			_ => {
+				let range = match (&value.ref_to, &value.points_to) {
+					(Some(r), _) => &r.reference_range,
+					(_, Some(p)) => &p.reference_range,
+					_ => unreachable!(),
+				};
+				let (container, variable) = match value.resolved {
+					Some(t) => (t.container as i32, t.variable.map_or(-1, |v| v as i32)),
+					None => (-1, -1),
+				};
+				let len = range.len().min(2);
+				let mut bounds = [0u16; 2];
+				bounds[..len].copy_from_slice(&range[..len]);
+				self.refs.push(format!("{{{}, {}, {}, {{{}, {}}}}}", container, variable, len, bounds[0], bounds[1]));
+				("ref", self.refs.len() as u32 - 1)
+			}
+		}
+	}
+}
+
+///
+/// Generate a C++17 header for a parsed (and resolved) document.
+/// Everything is emitted inside `namespace`
+///
+pub fn generate(parser: &RParser, namespace: &str) -> String {
+	let mut pools = Pools::default();
+	let mut vars: Vec<(u64, String)> = vec![];
+	let mut containers: Vec<String> = vec![];
+
+	for (c_idx, container) in parser.containers().iter().enumerate() {
+		containers.push(format!("{{{}, {}, {}}}", string_view(&container.c_name), vars.len(), container.values.len()));
+		for (name, value) in &container.values {
+			let hash = hash_parts(&container.c_name, name);
+			let (kind, offset, length, empty_type) = match value {
+				VarType::EmptyList(ds_type) => ("empty", 0, 0, ds_type.as_str()),
+				VarType::List(values) => {
+					// A list that fills one contiguous range of a single pool is emitted as
+					// that range; anything else goes through `items`
+					let placed: Vec<(&str, u32)> = values.iter().map(|v| pools.push(v)).collect();
+					let kind = match placed.first() {
+						Some((first, _)) if placed.iter().all(|(k, _)| k == first)
+							&& placed.windows(2).all(|w| w[1].1 == w[0].1 + 1) => *first,
+						Some(_) => "mixed",
+						None => "int64",
+					};
+					if kind == "mixed" {
+						let offset = pools.items.len();
+						for (k, idx) in &placed {
+							pools.items.push(format!("{{kind::{}, {}}}", k, idx));
+						}
+						("mixed", offset as u32, placed.len() as u32, "")
+					} else {
+						(kind, placed.first().map_or(0, |p| p.1), placed.len() as u32, "")
+					}
+				}
+			};
+			vars.push((hash, format!("{{{:#x}ull, {}, {}, kind::{}, {}, {}, {}}}",
+				hash, c_idx, string_view(name), kind, offset, length, string_view(empty_type))));
+		}
+	}
+
+	// Later duplicates of a path shadow earlier ones, matching RParser::lookup. The
+	// table holds one entry per hash; of two colliding paths only the later is found
+	let mut latest: HashMap<u64, u32> = HashMap::with_capacity(vars.len());
+	for (idx, (hash, _)) in vars.iter().enumerate() { latest.insert(*hash, idx as u32); }
+	let mut unique: Vec<(u64, u32)> = latest.into_iter().collect();
+	unique.sort();
+	let table = Phf::build(&unique.iter().map(|u| u.0).collect::<Vec<_>>());
+	let slots: Vec<String> = table.slots.iter()
+		.map(|&s| if s == phf::EMPTY { "0xffffffffu".to_string() } else { unique[s as usize].1.to_string() })
+		.collect();
+
+	let mut out = String::new();
+	writeln!(out, "// @generated by vtc codegen --lang cpp. Do not edit.").unwrap();
+	writeln!(out, "#pragma once\n").unwrap();
+	writeln!(out, "#include <array>\n#include <cstdint>\n#include <string_view>\n").unwrap();
+	writeln!(out, "namespace {} {{\n", namespace).unwrap();
+	writeln!(out, "{}", PRELUDE).unwrap();
+	array(&mut out, "std::int64_t", "ints", &pools.ints);
+	array(&mut out, "double", "floats", &pools.floats);
+	array(&mut out, "std::string_view", "strs", &pools.strs);
+	array(&mut out, "ref", "refs", &pools.refs);
+	array(&mut out, "item", "items", &pools.items);
+	array(&mut out, "var", "vars", &vars.into_iter().map(|v| v.1).collect::<Vec<_>>());
+	array(&mut out, "container", "containers", &containers);
+	array(&mut out, "std::uint32_t", "phf_seeds", &table.seeds.iter().map(|s| format!("{}u", s)).collect::<Vec<_>>());
+	array(&mut out, "std::uint32_t", "phf_slots", &slots);
+	writeln!(out, "{}", LOOKUP).unwrap();
+	writeln!(out, "}} // namespace {}", namespace).unwrap();
+	out
+}
+
+fn array(out: &mut String, ty: &str, name: &str, values: &[String]) {
+	writeln!(out, "inline constexpr std::array<{}, {}> {}{{{{", ty, values.len(), name).unwrap();
+	for value in values {
+		writeln!(out, "\t{},", value).unwrap();
+	}
+	writeln!(out, "}}}};\n").unwrap();
+}
+
+/// Escape `value` as a C++ `std::string_view` literal
+fn string_view(value: &str) -> String {
+	let mut lit = String::with_capacity(value.len() + 24);
+	lit.push_str("std::string_view(\"");
+	for b in value.bytes() {
+		match b {
+			b'"' => lit.push_str("\\\""),
+			b'\\' => lit.push_str("\\\\"),
+			b'?' => lit.push_str("\\?"),
+			0x20..=0x7e => lit.push(b as char),
+			_ => write!(lit, "\\{:03o}", b).unwrap(),
+		}
+	}
+	write!(lit, "\", {})", value.len()).unwrap();
+	lit
+}
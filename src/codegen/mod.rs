@@ -0,0 +1,3 @@
+pub mod cpp;
+pub mod phf;
+pub mod rust;
@@ -0,0 +1,89 @@
+//! Hash-and-displace perfect hashing over pre-computed 64-bit key hashes.
+//! Keys are split into buckets by their upper bits; each bucket searches for
+//! a seed that places all of its keys into free slots. A lookup is then one
+//! seed read, one `mix` and one slot read, which generated code can evaluate
+//! at compile time.
+
+use std::cmp::Reverse;
+
+/// Empty slot marker
+pub const EMPTY: u32 = u32::MAX;
+
+/// Seeded finalizer; generated lookups must mirror this exactly
+#[inline]
+pub const fn mix(hash: u64, seed: u32) -> u64 {
+	let mut x = hash ^ (seed as u64).wrapping_mul(0x9e3779b97f4a7c15);
+	x ^= x >> 33;
+	x = x.wrapping_mul(0xff51afd7ed558ccd);
+	x ^= x >> 33;
+	x
+}
+
+#[inline]
+pub const fn bucket(hash: u64, bucket_count: usize) -> usize {
+	((hash >> 32) % bucket_count as u64) as usize
+}
+
+///
+/// Perfect hash table
+/// * seeds: one displacement seed per bucket
+/// * slots: key index per slot, `EMPTY` when unused. Length is a power of two
+///
+pub struct Phf {
+	pub seeds: Vec<u32>,
+	pub slots: Vec<u32>,
+}
+
+impl Phf {
+	///
+	/// Build a table over `hashes`. Hashes must be distinct
+	///
+	pub fn build(hashes: &[u64]) -> Self {
+		let n = hashes.len();
+		let slot_count = (n + n / 4).max(1).next_power_of_two();
+		let bucket_count = ((n + 3) / 4).max(1);
+		let mask = slot_count as u64 - 1;
+
+		let mut buckets: Vec<Vec<u32>> = vec![vec![]; bucket_count];
+		for (idx, hash) in hashes.iter().enumerate() {
+			buckets[bucket(*hash, bucket_count)].push(idx as u32);
+		}
+		// Place the largest buckets first while the table is still sparse
+		let mut order: Vec<usize> = (0..bucket_count).collect();
+		order.sort_by_key(|&b| Reverse(buckets[b].len()));
+
+		let mut seeds = vec![0; bucket_count];
+		let mut slots = vec![EMPTY; slot_count];
+		let mut taken: Vec<usize> = vec![];
+		for b in order {
+			if buckets[b].is_empty() { break }
+
+			let mut seed = 0u32;
+			'search: loop {
+				taken.clear();
+				for &key in &buckets[b] {
+					let slot = (mix(hashes[key as usize], seed) & mask) as usize;
+					if slots[slot] != EMPTY || taken.contains(&slot) {
+						seed += 1;
+						continue 'search
+					}
+					taken.push(slot);
+				}
+				break
+			}
+
+			for (&key, &slot) in buckets[b].iter().zip(&taken) { slots[slot] = key; }
+			seeds[b] = seed;
+		}
+
+		Self { seeds, slots }
+	}
+
+	/// Returns the key index stored for `hash`, if any. Callers must verify the key itself
+	#[inline]
+	pub fn get(&self, hash: u64) -> Option<u32> {
+		let seed = self.seeds[bucket(hash, self.seeds.len())];
+		let slot = self.slots[(mix(hash, seed) & (self.slots.len() as u64 - 1)) as usize];
+		if slot == EMPTY { None } else { Some(slot) }
+	}
+}
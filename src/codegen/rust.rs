@@ -0,0 +1,210 @@
+//! Build-time embedding of vtc files.
+//! A build script parses the .vtc once and writes Rust source describing the
+//! containers as `static` data, which the crate then `include!`s:
+//!
+//! build.rs:
+//!     vtc::codegen::rust::embed("config/app.vtc", &format!("{}/app.rs", out_dir), "APP").unwrap();
+//!
+//! main.rs:
+//!     include!(concat!(env!("OUT_DIR"), "/app.rs"));
+//!     let ports = APP.ints(key!("server.ports"));
+//!
+//! Lists whose values share a type are emitted as typed slices. References
+//! and pointers are emitted as container/variable indices.
+
+use std::fmt::Write as FmtWrite;
+use std::fs;
+use std::io::{Error, ErrorKind};
+use crate::serializer::access::{hash_parts, Key};
+use crate::serializer::parser::{ListType, RParser, VarType};
+use crate::serializer::token::Tokens;
+use crate::serializer::types::{Types, ValType};
+
+/// Resolved reference: `variable` is -1 when the whole container is selected
+#[derive(Debug, Clone, Copy)]
+pub struct StaticRef {
+	pub container: i32,
+	pub variable: i32,
+	pub range: &'static [u16],
+}
+
+#[derive(Debug, Clone, Copy)]
+pub enum StaticValue {
+	Int(i64),
+	Float(f64),
+	Str(&'static str),
+	Ref(StaticRef),
+}
+
+#[derive(Debug, Clone, Copy)]
+pub enum StaticList {
+	Int(&'static [i64]),
+	Float(&'static [f64]),
+	Str(&'static [&'static str]),
+	Mixed(&'static [StaticValue]),
+	Empty(&'static str),
+}
+
+#[derive(Debug)]
+pub struct StaticVar {
+	pub name: &'static str,
+	pub list: StaticList,
+}
+
+#[derive(Debug)]
+pub struct StaticContainer {
+	pub name: &'static str,
+	pub vars: &'static [StaticVar],
+}
+
+///
+/// Embedded document
+/// * containers: containers in source order
+/// * keys: (path hash, path, container index, variable index) sorted by hash.
+///   Paths whose hashes collide each keep their own entry
+///
+#[derive(Debug)]
+pub struct StaticDoc {
+	pub containers: &'static [StaticContainer],
+	pub keys: &'static [(u64, &'static str, u32, u32)],
+}
+
+impl StaticDoc {
+	/// Look up the list stored at `key`
+	#[inline]
+	pub fn lookup(&self, key: Key) -> Option<&'static StaticList> {
+		let keys: &'static [(u64, &'static str, u32, u32)] = self.keys;
+		let first = keys.partition_point(|k| k.0 < key.hash);
+		let &(_, _, c_idx, v_idx) = keys[first..].iter()
+			.take_while(|k| k.0 == key.hash)
+			.find(|k| k.1 == key.path)?;
+		let containers: &'static [StaticContainer] = self.containers;
+		Some(&containers[c_idx as usize].vars[v_idx as usize].list)
+	}
+
+	pub fn ints(&self, key: Key) -> Option<&'static [i64]> {
+		match self.lookup(key)? { StaticList::Int(v) => Some(v), _ => None }
+	}
+
+	pub fn floats(&self, key: Key) -> Option<&'static [f64]> {
+		match self.lookup(key)? { StaticList::Float(v) => Some(v), _ => None }
+	}
+
+	pub fn strs(&self, key: Key) -> Option<&'static [&'static str]> {
+		match self.lookup(key)? { StaticList::Str(v) => Some(v), _ => None }
+	}
+}
+
+///
+/// Parse `input` and write the generated Rust source to `output`.
+/// `name` is the identifier of the emitted `static` StaticDoc.
+/// Nothing is written if the document has a syntax error
+///
+pub fn embed(input: &str, output: &str, name: &str) -> Result<(), Error> {
+	let mut tokens = Tokens::new(input)?;
+	tokens.tokenize()?;
+
+	let mut parser = RParser::new(tokens);
+	parser.generate_ast();
+	if let Some(error) = parser.error() {
+		return Err(Error::new(ErrorKind::InvalidData, format!("{}: {}", input, error)))
+	}
+	parser.resolve();
+
+	fs::write(output, generate(&parser, name))?;
+	println!("cargo:rerun-if-changed={}", input);
+	Ok(())
+}
+
+///
+/// Generate Rust source for a parsed (and resolved) document
+///
+pub fn generate(parser: &RParser, name: &str) -> String {
+	let mut out = String::new();
+	let mut keys: Vec<(u64, String, u32, u32)> = vec![];
+
+	writeln!(out, "// @generated by vtc::codegen::rust. Do not edit.").unwrap();
+	writeln!(out, "pub static {}: ::vtc::codegen::rust::StaticDoc = ::vtc::codegen::rust::StaticDoc {{", name).unwrap();
+	writeln!(out, "\tcontainers: &[").unwrap();
+	for (c_idx, container) in parser.containers().iter().enumerate() {
+		writeln!(out, "\t\t::vtc::codegen::rust::StaticContainer {{ name: {:?}, vars: &[", container.c_name).unwrap();
+		for (v_idx, (var, value)) in container.values.iter().enumerate() {
+			let path = format!("{}.{}", container.c_name, var);
+			keys.push((hash_parts(&container.c_name, var), path, c_idx as u32, v_idx as u32));
+			writeln!(out, "\t\t\t::vtc::codegen::rust::StaticVar {{ name: {:?}, list: {} }},", var, static_list(value)).unwrap();
+		}
+		writeln!(out, "\t\t] }},").unwrap();
+	}
+	writeln!(out, "\t],").unwrap();
+
+	// Later duplicates of a path shadow earlier ones, matching RParser::lookup.
+	// The sort is stable, so after reversing the latest definition comes first
+	keys.reverse();
+	keys.sort_by(|a, b| (a.0, &a.1).cmp(&(b.0, &b.1)));
+	keys.dedup_by(|a, b| a.0 == b.0 && a.1 == b.1);
+	write!(out, "\tkeys: &[").unwrap();
+	for (hash, path, c_idx, v_idx) in keys {
+		write!(out, "({:#x}, {:?}, {}, {}), ", hash, path, c_idx, v_idx).unwrap();
+	}
+	writeln!(out, "],\n}};").unwrap();
+	out
+}
+
+/// Value as it will be emitted
+enum Emit<'a> {
+	Int(i64),
+	Float(f64),
+	Str(&'a str),
+	Ref(String),
+}
+
+/// Classify a single value, falling back to a string when a numeric literal does not fit
+fn classify(value: &ListType) -> Emit<'_> {
+	match (&value.store_type, &value.val_type) {
+		(ValType::Value, Types::I64) if value.value.parse::<i64>().is_ok() =>
+			Emit::Int(value.value.parse().unwrap()),
+		(ValType::Value, Types::Float64) if value.value.parse::<f64>().is_ok() =>
+			Emit::Float(value.value.parse().unwrap()),
+		(ValType::Value, _) => Emit::Str(&value.value),
+		_ => {
+			let range = match (&value.ref_to, &value.points_to) {
+				(Some(r), _) => &r.reference_range,
+				(_, Some(p)) => &p.reference_range,
+				_ => unreachable!(),
+			};
+			let (container, variable) = match value.resolved {
+				Some(t) => (t.container as i32, t.variable.map_or(-1, |v| v as i32)),
+				None => (-1, -1),
+			};
+			Emit::Ref(format!("::vtc::codegen::rust::StaticRef {{ container: {}, variable: {}, range: &{:?} }}",
+				container, variable, range))
+		}
+	}
+}
+
+fn static_list(value: &VarType) -> String {
+	let values = match value {
+		VarType::EmptyList(ds_type) => return format!("::vtc::codegen::rust::StaticList::Empty({:?})", ds_type),
+		VarType::List(values) => values,
+	};
+
+	let elements: Vec<Emit> = values.iter().map(classify).collect();
+	let all = |f: fn(&Emit) -> bool| !elements.is_empty() && elements.iter().all(f);
+	let join = |f: &dyn Fn(&Emit) -> String| elements.iter().map(f).collect::<Vec<_>>().join(", ");
+
+	let (variant, body) = if all(|e| matches!(e, Emit::Int(_))) {
+		("Int", join(&|e| match e { Emit::Int(v) => v.to_string(), _ => unreachable!() }))
+	} else if all(|e| matches!(e, Emit::Float(_))) {
+		("Float", join(&|e| match e { Emit::Float(v) => format!("{:?}", v), _ => unreachable!() }))
+	} else if all(|e| matches!(e, Emit::Str(_))) {
+		("Str", join(&|e| match e { Emit::Str(v) => format!("{:?}", v), _ => unreachable!() }))
+	} else {
+		("Mixed", join(&|e| match e {
+			Emit::Int(v) => format!("::vtc::codegen::rust::StaticValue::Int({})", v),
+			Emit::Float(v) => format!("::vtc::codegen::rust::StaticValue::Float({:?})", v),
+			Emit::Str(v) => format!("::vtc::codegen::rust::StaticValue::Str({:?})", v),
+			Emit::Ref(v) => format!("::vtc::codegen::rust::StaticValue::Ref({})", v),
+		}))
+	};
+	format!("::vtc::codegen::rust::StaticList::{}(&[{}])", variant, body)
+}
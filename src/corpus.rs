@@ -0,0 +1,190 @@
+//! Deterministic synthetic corpora for benchmarks and scaling runs.
+//! The same (shape, seed) always produces the same text.
+
+use std::fmt::Write as FmtWrite;
+use std::io;
+
+/// xorshift64*; small, fast and stable across platforms
+pub struct Rng(u64);
+
+impl Rng {
+	pub fn new(seed: u64) -> Self { Self(seed.max(1)) }
+
+	#[inline]
+	pub fn next(&mut self) -> u64 {
+		self.0 ^= self.0 >> 12;
+		self.0 ^= self.0 << 25;
+		self.0 ^= self.0 >> 27;
+		self.0.wrapping_mul(0x2545f4914f6cdd1d)
+	}
+
+	/// Uniform in 0..bound
+	#[inline]
+	pub fn below(&mut self, bound: u64) -> u64 { self.next() % bound.max(1) }
+
+	/// True with probability `p`
+	#[inline]
+	pub fn chance(&mut self, p: f64) -> bool { ((self.next() >> 11) as f64) < p * (1u64 << 53) as f64 }
+}
+
+///
+/// Document shape
+/// * containers: number of `@` containers
+/// * vars: variables per container, pointer chain links included; 0 writes empty containers
+/// * list_len: values per list; 0 writes empty lists
+/// * numeric: share of plain values that are numbers (half ints, half floats); the rest are strings
+/// * refs: share of values that are `&container.variable` references to earlier variables
+/// * chain_depth: trailing variables of each container forming a `%` pointer chain
+/// * range: indices in each reference/pointer range; 0 references whole lists
+/// * comments: comment lines per variable
+///
+#[derive(Debug, Clone)]
+pub struct Shape {
+	pub containers: usize,
+	pub vars: usize,
+	pub list_len: usize,
+	pub numeric: f64,
+	pub refs: f64,
+	pub chain_depth: usize,
+	pub range: usize,
+	pub comments: f64,
+}
+
+impl Shape {
+	pub fn default() -> Self {
+		Self {
+			containers: 64,
+			vars: 8,
+			list_len: 4,
+			numeric: 0.66,
+			refs: 0.2,
+			chain_depth: 0,
+			range: 0,
+			comments: 0.1,
+		}
+	}
+
+	/// Scale the container count so the document is roughly `target_bytes`
+	pub fn sized(mut self, target_bytes: usize) -> Self {
+		let sample = Self { containers: 4, ..self.clone() }.generate(0).len() / 4;
+		self.containers = (target_bytes / sample.max(1)).max(1);
+		self
+	}
+
+	pub fn generate(&self, seed: u64) -> String {
+		let mut out = String::new();
+		self.write(seed, &mut StringWriter(&mut out)).unwrap();
+		out
+	}
+
+	///
+	/// Stream the document to `out` one container at a time, so documents far
+	/// larger than memory can be produced
+	///
+	pub fn write(&self, seed: u64, out: &mut impl io::Write) -> io::Result<()> {
+		let mut rng = Rng::new(seed);
+		let plain = self.plain_vars();
+		let mut buf = String::with_capacity(4096);
+
+		for c_idx in 0..self.containers {
+			buf.clear();
+			self.comment(&mut rng, &mut buf, c_idx);
+			writeln!(buf, "@c{}:", c_idx).unwrap();
+
+			for v_idx in 0..plain {
+				self.comment(&mut rng, &mut buf, c_idx);
+				write!(buf, "\t$v{} := [", v_idx).unwrap();
+				for i in 0..self.list_len {
+					if i > 0 { buf.push_str(", "); }
+					self.value(&mut rng, &mut buf, c_idx, v_idx);
+				}
+				buf.push_str("]\n");
+			}
+			// Each link points at the previous variable of the same container
+			for v_idx in plain..self.vars {
+				self.comment(&mut rng, &mut buf, c_idx);
+				write!(buf, "\t$v{} := [ %v{}", v_idx, v_idx - 1).unwrap();
+				self.range(&mut buf);
+				buf.push_str(" ]\n");
+			}
+			buf.push('\n');
+			out.write_all(buf.as_bytes())?;
+		}
+		Ok(())
+	}
+
+	/// Variables holding values; the rest form the pointer chain
+	#[inline]
+	fn plain_vars(&self) -> usize {
+		self.vars - self.chain_depth.min(self.vars.saturating_sub(1))
+	}
+
+	fn value(&self, rng: &mut Rng, buf: &mut String, c_idx: usize, v_idx: usize) {
+		// Only variables that are already defined can be referenced; `value` is only
+		// called for plain variables, so every earlier container has at least one
+		if (c_idx > 0 || v_idx > 0) && rng.chance(self.refs) {
+			let c = rng.below(c_idx as u64 + (v_idx > 0) as u64);
+			let v = match c as usize == c_idx {
+				true => rng.below(v_idx as u64),
+				false => rng.below(self.plain_vars() as u64),
+			};
+			write!(buf, "&c{}.v{}", c, v).unwrap();
+			self.range(buf);
+		} else if rng.chance(self.numeric) {
+			match rng.below(2) {
+				0 => write!(buf, "{}", rng.below(1_000_000)).unwrap(),
+				_ => write!(buf, "{}.{}", rng.below(1000), rng.below(1000)).unwrap(),
+			}
+		} else {
+			write!(buf, "s{}", rng.below(1_000_000)).unwrap();
+		}
+	}
+
+	fn range(&self, buf: &mut String) {
+		if self.range > 0 {
+			write!(buf, "->(0..{})", self.range - 1).unwrap();
+		}
+	}
+
+	fn comment(&self, rng: &mut Rng, buf: &mut String, c_idx: usize) {
+		let mut lines = self.comments;
+		while lines > 0.0 && rng.chance(lines) {
+			writeln!(buf, "# generated comment for container {}", c_idx).unwrap();
+			lines -= 1.0;
+		}
+	}
+}
+
+/// io::Write adapter over a String
+struct StringWriter<'a>(&'a mut String);
+
+impl io::Write for StringWriter<'_> {
+	fn write(&mut self, data: &[u8]) -> io::Result<usize> {
+		self.0.push_str(std::str::from_utf8(data).map_err(|e| io::Error::new(io::ErrorKind::InvalidData, e))?);
+		Ok(data.len())
+	}
+
+	fn flush(&mut self) -> io::Result<()> { Ok(()) }
+}
+
+///
+/// Parse a byte count with an optional K/M/G (binary) suffix, e.g. "64M"
+///
+pub fn parse_size(value: &str) -> Option<usize> {
+	let value = value.trim();
+	let (digits, shift) = match value.chars().last()? {
+		'K' | 'k' => (&value[..value.len() - 1], 10),
+		'M' | 'm' => (&value[..value.len() - 1], 20),
+		'G' | 'g' => (&value[..value.len() - 1], 30),
+		_ => (value, 0),
+	};
+	let n = digits.parse::<usize>().ok()?;
+	n.checked_mul(1 << shift)
+}
+
+///
+/// Generate a valid document of roughly `target_bytes` with the default shape
+///
+pub fn generate(target_bytes: usize, seed: u64) -> String {
+	Shape::default().sized(target_bytes).generate(seed)
+}
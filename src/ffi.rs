@@ -0,0 +1,268 @@
+//! C ABI, see include/vtc.h.
+//! Every view handed out (`vtc_str`, `vtc_list`) points into the loaded
+//! document and stays valid until `vtc_close` is called on it.
+//! Why the last `vtc_open`/`vtc_load` on a thread failed is kept for `vtc_last_error`.
+
+#![allow(non_camel_case_types)]
+
+use std::cell::RefCell;
+use std::ffi::CStr;
+use std::io::{Error, ErrorKind};
+use std::os::raw::{c_char, c_int};
+use std::panic;
+use std::ptr;
+use std::slice;
+use crate::serializer::access::FromValue;
+use crate::serializer::parser::{ListType, RParser, VarType};
+use crate::serializer::token::Tokens;
+use crate::serializer::types::{Types, ValType};
+
+pub const VTC_OK: c_int = 0;
+pub const VTC_NOT_FOUND: c_int = -1;
+pub const VTC_TYPE_MISMATCH: c_int = -2;
+pub const VTC_OUT_OF_RANGE: c_int = -3;
+
+#[repr(C)]
+pub enum vtc_kind {
+	VTC_INT64 = 0,
+	VTC_FLOAT64 = 1,
+	VTC_STR = 2,
+	VTC_REF = 3,
+	VTC_PTR = 4,
+}
+
+#[repr(C)]
+pub struct vtc_str {
+	pub ptr: *const c_char,
+	pub len: usize,
+}
+
+/// View over the values of one variable
+#[repr(C)]
+pub struct vtc_list {
+	pub items: *const ListType,
+	pub len: usize,
+}
+
+/// Opaque document handle
+pub struct vtc_doc {
+	parser: RParser,
+}
+
+impl vtc_str {
+	#[inline]
+	fn from(value: &str) -> Self {
+		Self { ptr: value.as_ptr() as *const c_char, len: value.len() }
+	}
+}
+
+#[inline]
+unsafe fn item<'a>(list: *const vtc_list, idx: usize) -> Option<&'a ListType> {
+	let list = list.as_ref()?;
+	if idx >= list.len { return None }
+	Some(&*list.items.add(idx))
+}
+
+/// Decode element `idx` of `list` into `out`
+#[inline]
+unsafe fn read<'a, T: FromValue<'a>>(list: *const vtc_list, idx: usize, out: *mut T) -> c_int {
+	let value = match item(list, idx) {
+		Some(v) => v,
+		None => return VTC_OUT_OF_RANGE,
+	};
+	match T::from_value(value) {
+		Some(v) if !out.is_null() => { out.write(v); VTC_OK },
+		_ => VTC_TYPE_MISMATCH,
+	}
+}
+
+/// Open, parse and resolve `path`. Returns NULL on failure
+#[no_mangle]
+pub unsafe extern "C" fn vtc_open(path: *const c_char) -> *mut vtc_doc {
+	if path.is_null() { return failed("path is NULL".to_string()) }
+	let path = match CStr::from_ptr(path).to_str() {
+		Ok(p) => p.to_string(),
+		Err(e) => return failed(e.to_string()),
+	};
+
+	load_doc(move || Tokens::new(&path))
+}
+
+/// Parse and resolve the `len` bytes of UTF-8 text at `data`, which are copied. Returns NULL on failure
+#[no_mangle]
+pub unsafe extern "C" fn vtc_load(data: *const c_char, len: usize) -> *mut vtc_doc {
+	if data.is_null() && len > 0 { return failed("data is NULL".to_string()) }
+	let data: &[u8] = match len {
+		0 => &[],
+		_ => slice::from_raw_parts(data as *const u8, len),
+	};
+	load_doc(move || Tokens::from_bytes(data))
+}
+
+thread_local! {
+	/// Why the last load on this thread failed; empty after a successful load
+	static LAST_ERROR: RefCell<String> = RefCell::new(String::new());
+}
+
+fn load_doc(tokens: impl FnOnce() -> Result<Tokens, Error> + panic::UnwindSafe) -> *mut vtc_doc {
+	// Unwinding across the C boundary is undefined; report failure instead
+	let parsed = panic::catch_unwind(move || {
+		let mut tokens = tokens()?;
+		tokens.tokenize()?;
+		let mut parser = RParser::new(tokens);
+		parser.generate_ast();
+		if let Some(error) = parser.error() {
+			return Err(Error::new(ErrorKind::InvalidData, error))
+		}
+		parser.resolve();
+		Ok(parser)
+	});
+	match parsed {
+		Ok(Ok(parser)) => {
+			LAST_ERROR.with(|last| last.borrow_mut().clear());
+			Box::into_raw(Box::new(vtc_doc { parser }))
+		},
+		Ok(Err(e)) => failed(e.to_string()),
+		Err(_) => failed("panicked while loading".to_string()),
+	}
+}
+
+/// Record `error` for `vtc_last_error` and return NULL
+fn failed(error: String) -> *mut vtc_doc {
+	LAST_ERROR.with(|last| *last.borrow_mut() = error);
+	ptr::null_mut()
+}
+
+///
+/// Why the last `vtc_open`/`vtc_load` on this thread returned NULL. VTC_NOT_FOUND if it
+/// succeeded. The message stays valid until the next load on this thread
+///
+#[no_mangle]
+pub unsafe extern "C" fn vtc_last_error(out: *mut vtc_str) -> c_int {
+	LAST_ERROR.with(|last| {
+		let last = last.borrow();
+		if last.is_empty() { return VTC_NOT_FOUND }
+		if !out.is_null() { out.write(vtc_str::from(&last)); }
+		VTC_OK
+	})
+}
+
+/// Release a document returned by `vtc_open`. Invalidates every view into it
+#[no_mangle]
+pub unsafe extern "C" fn vtc_close(doc: *mut vtc_doc) {
+	if !doc.is_null() { drop(Box::from_raw(doc)); }
+}
+
+/// Number of containers in the document
+#[no_mangle]
+pub unsafe extern "C" fn vtc_container_count(doc: *const vtc_doc) -> usize {
+	doc.as_ref().map_or(0, |d| d.parser.containers().len())
+}
+
+/// Name of container `idx`
+#[no_mangle]
+pub unsafe extern "C" fn vtc_container_name(doc: *const vtc_doc, idx: usize, out: *mut vtc_str) -> c_int {
+	let container = match doc.as_ref().and_then(|d| d.parser.containers().get(idx)) {
+		Some(c) => c,
+		None => return VTC_OUT_OF_RANGE,
+	};
+	if !out.is_null() { out.write(vtc_str::from(&container.c_name)); }
+	VTC_OK
+}
+
+/// Query "container.variable". `path` need not be NUL-terminated
+#[no_mangle]
+pub unsafe extern "C" fn vtc_query(doc: *const vtc_doc, path: *const c_char, path_len: usize, out: *mut vtc_list) -> c_int {
+	let doc = match doc.as_ref() {
+		Some(d) if !path.is_null() => d,
+		_ => return VTC_NOT_FOUND,
+	};
+	let path = match std::str::from_utf8(slice::from_raw_parts(path as *const u8, path_len)) {
+		Ok(path) => path,
+		Err(_) => return VTC_NOT_FOUND,
+	};
+	let list = match doc.parser.lookup_path(path) {
+		Some(VarType::List(values)) => vtc_list { items: values.as_ptr(), len: values.len() },
+		Some(VarType::EmptyList(_)) => vtc_list { items: ptr::null(), len: 0 },
+		None => return VTC_NOT_FOUND,
+	};
+	if !out.is_null() { out.write(list); }
+	VTC_OK
+}
+
+/// Kind of element `idx`; VTC_OUT_OF_RANGE when `idx` is past the end
+#[no_mangle]
+pub unsafe extern "C" fn vtc_value_kind(list: *const vtc_list, idx: usize) -> c_int {
+	let value = match item(list, idx) {
+		Some(v) => v,
+		None => return VTC_OUT_OF_RANGE,
+	};
+	let kind = match (&value.store_type, &value.val_type) {
+		(ValType::Ref, _) => vtc_kind::VTC_REF,
+		(ValType::Ptr, _) => vtc_kind::VTC_PTR,
+		(ValType::Value, Types::I64) => vtc_kind::VTC_INT64,
+		(ValType::Value, Types::Float64) => vtc_kind::VTC_FLOAT64,
+		_ => vtc_kind::VTC_STR,
+	};
+	kind as c_int
+}
+
+/// Raw text of element `idx` (for references, the referenced path)
+#[no_mangle]
+pub unsafe extern "C" fn vtc_value_str(list: *const vtc_list, idx: usize, out: *mut vtc_str) -> c_int {
+	match item(list, idx) {
+		Some(v) => {
+			if !out.is_null() { out.write(vtc_str::from(&v.value)); }
+			VTC_OK
+		},
+		None => VTC_OUT_OF_RANGE,
+	}
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn vtc_value_i64(list: *const vtc_list, idx: usize, out: *mut i64) -> c_int {
+	read(list, idx, out)
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn vtc_value_f64(list: *const vtc_list, idx: usize, out: *mut f64) -> c_int {
+	read(list, idx, out)
+}
+
+/// Resolved target of a reference/pointer. `variable` is -1 when the whole container is selected
+#[no_mangle]
+pub unsafe extern "C" fn vtc_value_target(list: *const vtc_list, idx: usize, container: *mut u32, variable: *mut i32) -> c_int {
+	let value = match item(list, idx) {
+		Some(v) => v,
+		None => return VTC_OUT_OF_RANGE,
+	};
+	match value.resolved {
+		Some(target) => {
+			if !container.is_null() { container.write(target.container); }
+			if !variable.is_null() { variable.write(target.variable.map_or(-1, |v| v as i32)); }
+			VTC_OK
+		},
+		None if value.store_type == ValType::Value => VTC_TYPE_MISMATCH,
+		None => VTC_NOT_FOUND,
+	}
+}
+
+///
+/// Index range of a reference/pointer: `len` is 0 when the whole target is selected,
+/// 1 for a single index and 2 for an inclusive `from..to`. `range` points into the document
+///
+#[no_mangle]
+pub unsafe extern "C" fn vtc_value_range(list: *const vtc_list, idx: usize, range: *mut *const u16, len: *mut usize) -> c_int {
+	let value = match item(list, idx) {
+		Some(v) => v,
+		None => return VTC_OUT_OF_RANGE,
+	};
+	let bounds = match (&value.ref_to, &value.points_to) {
+		(Some(r), _) => &r.reference_range,
+		(_, Some(p)) => &p.reference_range,
+		_ => return VTC_TYPE_MISMATCH,
+	};
+	if !range.is_null() { range.write(bounds.as_ptr()); }
+	if !len.is_null() { len.write(bounds.len()); }
+	VTC_OK
+}
@@ -1,6 +1,13 @@
 
 pub mod cli;
 pub mod serializer;
+pub mod codegen;
+pub mod ffi;
+pub mod corpus;
+pub mod alloc;
+pub mod ring;
+pub mod trace;
+pub mod batch;
 
 pub struct Stack<T> {
 	stack: Vec<T>
@@ -1,14 +1,168 @@
+use std::fs;
+use std::io::{self, Read};
+use std::path::Path;
+use std::process;
+use std::thread;
 use clap::Parser;
-use vtc::cli::Args;
+use vtc::batch;
+use vtc::cli::{Args, Command};
+use vtc::codegen;
+use vtc::alloc::{self, CountingAlloc};
+use vtc::serializer::compiled::DiskCache;
+use vtc::serializer::explain;
 use vtc::serializer::parser::RParser;
+use vtc::serializer::stats::{self, Stats};
+use vtc::serializer::stream;
 use vtc::serializer::token::Tokens;
 
+/// Backs --one-shot; counts allocations only under --stats
+#[global_allocator]
+static ALLOC: CountingAlloc = CountingAlloc;
+
+/// `--trace` output, written by `exit`
+#[cfg(feature = "trace")]
+static TRACE: std::sync::OnceLock<String> = std::sync::OnceLock::new();
+
+/// Exit with `code`. Every exit goes through here so the trace is saved on failures too
+fn exit(code: i32) -> ! {
+	#[cfg(feature = "trace")]
+	if let Some(path) = TRACE.get() {
+		if let Err(e) = vtc::trace::save(Path::new(path)) { eprintln!("{}: {}", path, e); }
+	}
+	process::exit(code)
+}
+
+/// Report `msg` and exit with a failure status
+fn fail(msg: String) -> ! {
+	eprintln!("{}", msg);
+	exit(1);
+}
+
+/// `-` reads stdin
+const STDIN: &str = "-";
+
+fn open(filename: &str, profiles: &[String]) -> Tokens {
+	let tokens = match filename {
+		STDIN => Tokens::from_reader(io::stdin().lock()),
+		_ => Tokens::new(filename),
+	};
+	let mut tokens = tokens.unwrap_or_else(|e| fail(format!("{}: {}", filename, e)));
+	if !profiles.is_empty() {
+		tokens.set_profiles(&profiles.iter().map(String::as_str).collect::<Vec<_>>());
+	}
+	tokens
+}
+
+fn tokenize(filename: &str, profiles: &[String]) -> Tokens {
+	let mut tokens = open(filename, profiles);
+	tokens.tokenize().unwrap_or_else(|e| fail(format!("{}: {}", filename, e)));
+	tokens
+}
 
 fn main() {
 	let args = Args::parse();
-	let mut tokens = Tokens::new(args.filename.as_str()).unwrap();
-	tokens.tokenize().unwrap();
+	#[cfg(feature = "trace")]
+	if let Some(path) = &args.trace { TRACE.set(path.clone()).unwrap(); }
+	if args.one_shot { alloc::one_shot(); }
+	if args.stats { alloc::enable_counting(); }
+	let inputs: Vec<String> = args.filename.iter().chain(&args.paths).cloned().collect();
+	match inputs.as_slice() {
+		[] => {
+			eprintln!("No input files; pass --filename or paths");
+			exit(2);
+		},
+		[single] if single == STDIN || Path::new(single).is_file() => run_single(&args, single),
+		_ => run_batch(&args, &inputs),
+	}
+	exit(0);
+}
+
+fn run_single(args: &Args, filename: &str) {
+	let mut stats = Stats::new();
+	let mut p_obj = match &args.cache_dir {
+		// Attribution needs a real parse, so the cache is bypassed
+		_ if args.explain.is_some() => {
+			let mut p_obj = RParser::new(tokenize(filename, &args.profile));
+			let report = explain::explain(&mut p_obj);
+			eprint!("{}", report.table(args.explain.unwrap()));
+			p_obj
+		},
+		Some(dir) => {
+			let (p_obj, bytes_read) = stats.phase("cache", || {
+				let source = match filename {
+					STDIN => read_stdin(),
+					_ => fs::read(filename),
+				}?;
+				let bytes_read = source.len();
+				DiskCache::new(Path::new(dir))?.load_bytes(source, &args.profile).map(|p| (p, bytes_read))
+			}).unwrap_or_else(|e| fail(format!("{}: {}", filename, e)));
+			stats.bytes_read = bytes_read;
+			stats.count_document(&p_obj);
+			p_obj
+		},
+		None if args.stats => {
+			let loaded = match filename {
+				STDIN => stats::load_reader(io::stdin().lock(), &args.profile),
+				_ => stats::load(filename, &args.profile),
+			};
+			let (p_obj, load_stats) = loaded.unwrap_or_else(|e| fail(format!("{}: {}", filename, e)));
+			stats = load_stats;
+			p_obj
+		},
+		None if args.overlap => stream::parse(open(filename, &args.profile))
+			.unwrap_or_else(|e| fail(format!("{}: {}", filename, e))),
+		None => {
+			let mut p_obj = RParser::new(tokenize(filename, &args.profile));
+			p_obj.generate_ast();
+			p_obj
+		}
+	};
+	if let Some(error) = p_obj.error() { fail(format!("{}: {}", filename, error)); }
+
+	if let Some(Command::Codegen { lang, name, output }) = &args.command {
+		p_obj.resolve();
+		let source = match lang.as_str() {
+			"cpp" => codegen::cpp::generate(&p_obj, name.as_deref().unwrap_or("vtc_config")),
+			"rust" => codegen::rust::generate(&p_obj, name.as_deref().unwrap_or("CONFIG")),
+			_ => {
+				eprintln!("Unsupported codegen language: {}", lang);
+				exit(2);
+			}
+		};
+		match output {
+			Some(path) => fs::write(path, source).unwrap(),
+			None => print!("{}", source),
+		}
+	}
+
+	if args.stats { eprintln!("{}", stats); }
+	alloc::discard(p_obj);
+}
+
+fn read_stdin() -> Result<Vec<u8>, io::Error> {
+	let mut source = vec![];
+	io::stdin().lock().read_to_end(&mut source)?;
+	Ok(source)
+}
+
+fn run_batch(args: &Args, inputs: &[String]) {
+	if inputs.iter().any(|input| input == STDIN) {
+		fail("- (stdin) must be the only input".to_string());
+	}
+	if args.command.is_some() || args.explain.is_some() || args.stats || args.cache_dir.is_some() || args.overlap {
+		fail("codegen, --explain, --stats, --cache-dir and --overlap take a single file".to_string());
+	}
+	let paths = batch::expand(inputs).unwrap_or_else(|e| fail(e.to_string()));
+	let jobs = args.jobs.unwrap_or_else(|| thread::available_parallelism().map_or(1, |n| n.get()));
 
-	let mut p_obj = RParser::new(tokens);
-	p_obj.generate_ast();
+	let results = batch::check_all(&paths, &args.profile, jobs);
+	let mut failed = 0;
+	for result in &results {
+		if let Some(error) = &result.error {
+			failed += 1;
+			eprintln!("{}: {}", result.path.display(), error);
+		}
+	}
+	println!("{} files checked, {} failed", results.len(), failed);
+	if failed > 0 { exit(1); }
 }
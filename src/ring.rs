@@ -0,0 +1,161 @@
+//! Bounded lock-free single-producer/single-consumer ring buffer.
+//! The producer publishes what it has written once per batch, and the consumer
+//! takes everything published at once, so the shared indexes move once per batch
+//! instead of once per item. Waiting sides spin briefly, then yield.
+
+use std::cell::UnsafeCell;
+use std::hint;
+use std::mem::MaybeUninit;
+use std::ops::Deref;
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::thread;
+
+/// Keeps the producer's and consumer's indexes on separate cache lines
+#[repr(align(64))]
+struct Padded<T>(T);
+
+impl<T> Deref for Padded<T> {
+	type Target = T;
+	fn deref(&self) -> &T { &self.0 }
+}
+
+struct Ring<T> {
+	slots: Box<[UnsafeCell<MaybeUninit<T>>]>,
+	mask: usize,
+	/// Items read so far; written by the consumer only
+	head: Padded<AtomicUsize>,
+	/// Items published so far; written by the producer only
+	tail: Padded<AtomicUsize>,
+	producer_closed: AtomicBool,
+	consumer_closed: AtomicBool,
+}
+
+// Each slot is accessed by one side at a time, as handed over through `head`/`tail`
+unsafe impl<T: Send> Sync for Ring<T> {}
+
+impl<T> Drop for Ring<T> {
+	fn drop(&mut self) {
+		let (head, tail) = (*self.head.0.get_mut(), *self.tail.0.get_mut());
+		for at in head..tail {
+			unsafe { self.slots[at & self.mask].get_mut().assume_init_drop() }
+		}
+	}
+}
+
+/// Writing end of a ring; closes the ring when dropped
+pub struct Producer<T> {
+	ring: Arc<Ring<T>>,
+	/// Items written, published or not
+	tail: usize,
+	published: usize,
+	/// Last head seen; the ring has at least `capacity - (tail - head)` free slots
+	head: usize,
+	batch: usize,
+}
+
+/// Reading end of a ring
+pub struct Consumer<T> {
+	ring: Arc<Ring<T>>,
+	head: usize,
+}
+
+///
+/// Create a ring holding at least `capacity` items (rounded up to a power of two)
+/// whose producer publishes every `batch` items
+///
+pub fn channel<T: Send>(capacity: usize, batch: usize) -> (Producer<T>, Consumer<T>) {
+	let capacity = capacity.max(1).next_power_of_two();
+	let ring = Arc::new(Ring {
+		slots: (0..capacity).map(|_| UnsafeCell::new(MaybeUninit::uninit())).collect(),
+		mask: capacity - 1,
+		head: Padded(AtomicUsize::new(0)),
+		tail: Padded(AtomicUsize::new(0)),
+		producer_closed: AtomicBool::new(false),
+		consumer_closed: AtomicBool::new(false),
+	});
+	let batch = batch.clamp(1, capacity);
+	(Producer { ring: ring.clone(), tail: 0, published: 0, head: 0, batch }, Consumer { ring, head: 0 })
+}
+
+/// Spin for a while, then give the CPU away
+#[inline]
+fn backoff(spins: &mut u32) {
+	match *spins < 64 {
+		true => hint::spin_loop(),
+		false => thread::yield_now(),
+	}
+	*spins += 1;
+}
+
+impl<T> Producer<T> {
+	///
+	/// Write `value`, waiting while the ring is full. Returns the value back
+	/// if the consumer is gone
+	///
+	pub fn push(&mut self, value: T) -> Result<(), T> {
+		let capacity = self.ring.mask + 1;
+		let mut spins = 0;
+		while self.tail - self.head == capacity {
+			// Let the consumer see everything before waiting on it
+			self.publish();
+			self.head = self.ring.head.load(Ordering::Acquire);
+			if self.tail - self.head < capacity { break }
+			if self.ring.consumer_closed.load(Ordering::Acquire) { return Err(value) }
+			backoff(&mut spins);
+		}
+
+		unsafe { (*self.ring.slots[self.tail & self.ring.mask].get()).write(value); }
+		self.tail += 1;
+		if self.tail - self.published >= self.batch { self.publish(); }
+		Ok(())
+	}
+
+	/// Make every written item visible to the consumer
+	#[inline]
+	pub fn publish(&mut self) {
+		if self.published == self.tail { return }
+		self.ring.tail.store(self.tail, Ordering::Release);
+		self.published = self.tail;
+	}
+}
+
+impl<T> Drop for Producer<T> {
+	fn drop(&mut self) {
+		self.publish();
+		self.ring.producer_closed.store(true, Ordering::Release);
+	}
+}
+
+impl<T> Consumer<T> {
+	///
+	/// Move every published item to `out`, waiting until there is at least one.
+	/// Returns false once the producer is gone and the ring is drained
+	///
+	pub fn pop_into(&mut self, out: &mut Vec<T>) -> bool {
+		let mut spins = 0;
+		loop {
+			let tail = self.ring.tail.load(Ordering::Acquire);
+			if tail != self.head {
+				out.reserve(tail - self.head);
+				for at in self.head..tail {
+					out.push(unsafe { (*self.ring.slots[at & self.ring.mask].get()).assume_init_read() });
+				}
+				self.head = tail;
+				self.ring.head.store(tail, Ordering::Release);
+				return true
+			}
+			// The producer publishes before closing, so a closed ring is re-checked once
+			if self.ring.producer_closed.load(Ordering::Acquire) && self.ring.tail.load(Ordering::Acquire) == self.head {
+				return false
+			}
+			backoff(&mut spins);
+		}
+	}
+}
+
+impl<T> Drop for Consumer<T> {
+	fn drop(&mut self) {
+		self.ring.consumer_closed.store(true, Ordering::Release);
+	}
+}
@@ -0,0 +1,126 @@
+use std::collections::HashMap;
+use std::hash::{BuildHasherDefault, Hasher};
+use crate::serializer::parser::ListType;
+
+const FNV_OFFSET: u64 = 0xcbf29ce484222325;
+const FNV_PRIME: u64 = 0x100000001b3;
+
+///
+/// FNV-1a over `bytes`, continuing from `seed`.
+/// `const` so that paths passed through `key!` are hashed at compile time
+///
+#[inline]
+pub const fn fnv1a(seed: u64, bytes: &[u8]) -> u64 {
+	let mut hash = seed;
+	let mut idx = 0;
+	while idx < bytes.len() {
+		hash ^= bytes[idx] as u64;
+		hash = hash.wrapping_mul(FNV_PRIME);
+		idx += 1;
+	}
+	hash
+}
+
+/// Hash a dotted path such as "values.integers"
+#[inline]
+pub const fn hash_path(path: &str) -> u64 {
+	hash_bytes(path.as_bytes())
+}
+
+/// Hash a dotted path given as raw bytes
+#[inline]
+pub const fn hash_bytes(path: &[u8]) -> u64 {
+	fnv1a(FNV_OFFSET, path)
+}
+
+/// Hash `container` + '.' + `variable` without building the joined string
+#[inline]
+pub fn hash_parts(container: &str, variable: &str) -> u64 {
+	let hash = fnv1a(FNV_OFFSET, container.as_bytes());
+	let hash = fnv1a(hash, b".");
+	fnv1a(hash, variable.as_bytes())
+}
+
+///
+/// Pre-hashed lookup key: <container>.<variable>
+/// Use `key!("container.variable")` to build one at compile time
+///
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct Key {
+	pub hash: u64,
+	pub path: &'static str,
+}
+
+impl Key {
+	#[inline]
+	pub const fn new(path: &'static str) -> Self {
+		Self { hash: hash_path(path), path }
+	}
+}
+
+///
+/// Builds a `Key` whose hash is evaluated at compile time
+/// ```ignore
+/// let ints = parser.get_list::<i64>(key!("values.integers"));
+/// ```
+///
+#[macro_export]
+macro_rules! key {
+	($path:literal) => {{
+		const KEY: $crate::serializer::access::Key = $crate::serializer::access::Key::new($path);
+		KEY
+	}};
+}
+
+///
+/// Keys are already FNV hashed; the index hasher passes the value through
+/// instead of hashing it a second time
+///
+#[derive(Default)]
+pub struct KeyHasher(u64);
+
+impl Hasher for KeyHasher {
+	#[inline]
+	fn finish(&self) -> u64 { self.0 }
+
+	#[inline]
+	fn write(&mut self, bytes: &[u8]) {
+		self.0 = fnv1a(self.0 ^ FNV_OFFSET, bytes);
+	}
+
+	#[inline]
+	fn write_u64(&mut self, value: u64) { self.0 = value; }
+}
+
+/// Path hash -> (container index, variable index)
+pub type KeyIndex = HashMap<u64, (u32, u32), BuildHasherDefault<KeyHasher>>;
+
+///
+/// Decodes a single list element into `Self`.
+/// Each implementation is monomorphized at the call site; no dispatch
+/// over `Types`/`LitKind` happens on the read path
+///
+pub trait FromValue<'a>: Sized {
+	fn from_value(value: &'a ListType) -> Option<Self>;
+}
+
+macro_rules! from_value_parse {
+	($($t:ty),*) => {
+		$(impl<'a> FromValue<'a> for $t {
+			#[inline]
+			fn from_value(value: &'a ListType) -> Option<Self> { value.value.parse::<$t>().ok() }
+		})*
+	};
+}
+
+from_value_parse!(i8, i16, i32, i64, u8, u16, u32, u64, f32, f64, bool, char);
+
+impl<'a> FromValue<'a> for &'a str {
+	#[inline]
+	fn from_value(value: &'a ListType) -> Option<Self> { Some(value.value.as_str()) }
+}
+
+impl<'a> FromValue<'a> for String {
+	#[inline]
+	fn from_value(value: &'a ListType) -> Option<Self> { Some(value.value.clone()) }
+}
@@ -0,0 +1,340 @@
+//! Compiled (binary) form of a parsed document and the opt-in on-disk cache built on it.
+//!
+//! Layout, little-endian; strings are u32 length + UTF-8 bytes:
+//!     "VTCC" | u32 format | str crate version | u64 source hash, u64 source length, u64 source check
+//!     u32 profile count   | str*  (sorted, as given to `encode`)
+//!     u32 tag count       | (str, str)*
+//!     u32 container count | (str name, u32 var count, Var*)*
+//!     Var:   str name, u8 0 = EmptyList(str) | 1 = List(u32 count, Value*)
+//!     Value: u8 store type, u8 value type, str value,
+//!            u8 has ref  [str path, Range],
+//!            u8 has ptr  [str container, str value, Range],
+//!            u8 resolved [u32 container, u8 has variable, u32 variable]
+//!     Range: u32 count, u16*
+
+use std::fs;
+use std::io::{Error, ErrorKind};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+use crate::serializer::access::{fnv1a, hash_bytes};
+use crate::serializer::parser::{ListType, PContainer, Pointer, RParser, Reference, Tag, Target, VarType};
+use crate::serializer::token::Tokens;
+use crate::serializer::types::{Types, ValType};
+
+const MAGIC: &[u8; 4] = b"VTCC";
+const FORMAT: u32 = 3;
+const VERSION: &str = env!("CARGO_PKG_VERSION");
+
+const TYPES: [Types; 15] = [
+	Types::I8, Types::I16, Types::I32, Types::I64, Types::U8, Types::U16, Types::U32, Types::U64,
+	Types::Float8, Types::Float16, Types::Float32, Types::Float64, Types::Float128, Types::Char, Types::Str,
+];
+const VAL_TYPES: [ValType; 3] = [ValType::Ptr, ValType::Ref, ValType::Value];
+
+///
+/// Identifies the source a document was compiled from. Two sources are taken to be
+/// the same only if the FNV-1a hash, the length and a second, unrelated digest all match
+///
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct SourceId {
+	pub hash: u64,
+	pub len: u64,
+	pub check: u64,
+}
+
+impl SourceId {
+	pub fn of(source: &[u8]) -> Self {
+		// Polynomial hash with another multiplier and a different mixing order than FNV-1a
+		let check = source.iter().fold(0u64, |h, &b| h.wrapping_mul(0x9e3779b97f4a7c15).wrapping_add(b as u64 + 1));
+		Self { hash: hash_bytes(source), len: source.len() as u64, check }
+	}
+}
+
+///
+/// Encode the parsed document. `source` identifies the source it was parsed from
+/// and `profiles` the profiles active while parsing, see `profile_set`
+///
+pub fn encode(parser: &RParser, source: SourceId, profiles: &[&str]) -> Vec<u8> {
+	let _span = crate::span!("compile");
+	let mut out = Vec::with_capacity(4096);
+	out.extend_from_slice(MAGIC);
+	put_u32(&mut out, FORMAT);
+	put_str(&mut out, VERSION);
+	for word in [source.hash, source.len, source.check] {
+		out.extend_from_slice(&word.to_le_bytes());
+	}
+	put_u32(&mut out, profiles.len() as u32);
+	for profile in profiles { put_str(&mut out, profile); }
+
+	put_u32(&mut out, parser.tags().len() as u32);
+	for tag in parser.tags() {
+		put_str(&mut out, &tag.t_value_1);
+		put_str(&mut out, &tag.t_value_2);
+	}
+
+	put_u32(&mut out, parser.containers().len() as u32);
+	for container in parser.containers() {
+		put_str(&mut out, &container.c_name);
+		put_u32(&mut out, container.values.len() as u32);
+		for (name, value) in &container.values {
+			put_str(&mut out, name);
+			match value {
+				VarType::EmptyList(ds_type) => { out.push(0); put_str(&mut out, ds_type); },
+				VarType::List(values) => {
+					out.push(1);
+					put_u32(&mut out, values.len() as u32);
+					for value in values { put_value(&mut out, value); }
+				}
+			}
+		}
+	}
+	out
+}
+
+fn put_value(out: &mut Vec<u8>, value: &ListType) {
+	out.push(VAL_TYPES.iter().position(|t| *t == value.store_type).unwrap() as u8);
+	out.push(TYPES.iter().position(|t| *t == value.val_type).unwrap() as u8);
+	put_str(out, &value.value);
+
+	match &value.ref_to {
+		Some(r) => { out.push(1); put_str(out, &r.to_ref_value); put_range(out, &r.reference_range); },
+		None => out.push(0),
+	}
+	match &value.points_to {
+		Some(p) => {
+			out.push(1);
+			put_str(out, &p.pointing_container);
+			put_str(out, &p.pointing_value);
+			put_range(out, &p.reference_range);
+		},
+		None => out.push(0),
+	}
+	match &value.resolved {
+		Some(t) => {
+			out.push(1);
+			put_u32(out, t.container);
+			out.push(t.variable.is_some() as u8);
+			put_u32(out, t.variable.unwrap_or(0));
+		},
+		None => out.push(0),
+	}
+}
+
+#[inline]
+fn put_u32(out: &mut Vec<u8>, value: u32) { out.extend_from_slice(&value.to_le_bytes()); }
+
+#[inline]
+fn put_str(out: &mut Vec<u8>, value: &str) {
+	put_u32(out, value.len() as u32);
+	out.extend_from_slice(value.as_bytes());
+}
+
+fn put_range(out: &mut Vec<u8>, range: &[u16]) {
+	put_u32(out, range.len() as u32);
+	for at in range { out.extend_from_slice(&at.to_le_bytes()); }
+}
+
+///
+/// Decode a compiled document. Fails when the data is truncated, was written
+/// by another crate version, or does not match `source` and `profiles`
+///
+pub fn decode(data: &[u8], source: SourceId, profiles: &[&str]) -> Result<RParser, Error> {
+	let _span = crate::span!("load compiled", data.len());
+	let mut r = Reader { data, at: 0 };
+	if r.take(4)? != MAGIC || r.u32()? != FORMAT || r.str()? != VERSION {
+		return Err(invalid("compiled data was written by another vtc version"))
+	}
+	let stored = SourceId { hash: r.u64()?, len: r.u64()?, check: r.u64()? };
+	if stored != source {
+		return Err(invalid("compiled data does not match its source"))
+	}
+	let profile_count = r.u32()? as usize;
+	if profile_count != profiles.len() || profiles.iter().any(|p| r.str().map_or(true, |stored| stored != *p)) {
+		return Err(invalid("compiled data was parsed with other profiles"))
+	}
+
+	let tag_count = r.u32()?;
+	let mut tags = Vec::with_capacity(r.bounded(tag_count));
+	for _ in 0..tag_count {
+		tags.push(Tag { t_value_1: r.str()?, t_value_2: r.str()? });
+	}
+
+	let container_count = r.u32()?;
+	let mut containers = Vec::with_capacity(r.bounded(container_count));
+	for _ in 0..container_count {
+		let mut container = PContainer::default();
+		container.c_name = r.str()?;
+		let var_count = r.u32()?;
+		container.values.reserve(r.bounded(var_count));
+		for _ in 0..var_count {
+			let name = r.str()?;
+			let value = match r.u8()? {
+				0 => VarType::EmptyList(r.str()?),
+				_ => {
+					let count = r.u32()?;
+					let mut values = Vec::with_capacity(r.bounded(count));
+					for _ in 0..count { values.push(r.value()?); }
+					VarType::List(values)
+				}
+			};
+			container.values.push((name, value));
+		}
+		containers.push(container);
+	}
+
+	Ok(RParser::from_parts(tags, containers))
+}
+
+struct Reader<'a> {
+	data: &'a [u8],
+	at: usize,
+}
+
+impl<'a> Reader<'a> {
+	#[inline]
+	fn take(&mut self, len: usize) -> Result<&'a [u8], Error> {
+		if self.at + len > self.data.len() { return Err(invalid("compiled data is truncated")) }
+		let bytes = &self.data[self.at..self.at + len];
+		self.at += len;
+		Ok(bytes)
+	}
+
+	///
+	/// Capacity to reserve for `count` items read from the data. Every item takes at
+	/// least a byte, so a corrupt count cannot reserve more than the data could hold
+	///
+	#[inline]
+	fn bounded(&self, count: u32) -> usize {
+		(count as usize).min(self.data.len() - self.at)
+	}
+
+	#[inline]
+	fn u8(&mut self) -> Result<u8, Error> { Ok(self.take(1)?[0]) }
+
+	#[inline]
+	fn u32(&mut self) -> Result<u32, Error> { Ok(u32::from_le_bytes(self.take(4)?.try_into().unwrap())) }
+
+	#[inline]
+	fn u64(&mut self) -> Result<u64, Error> { Ok(u64::from_le_bytes(self.take(8)?.try_into().unwrap())) }
+
+	#[inline]
+	fn str(&mut self) -> Result<String, Error> {
+		let len = self.u32()? as usize;
+		String::from_utf8(self.take(len)?.to_vec()).map_err(|e| Error::new(ErrorKind::InvalidData, e))
+	}
+
+	fn range(&mut self) -> Result<Vec<u16>, Error> {
+		let count = self.u32()?;
+		(0..count).map(|_| Ok(u16::from_le_bytes(self.take(2)?.try_into().unwrap()))).collect()
+	}
+
+	fn value(&mut self) -> Result<ListType, Error> {
+		let store_type = *VAL_TYPES.get(self.u8()? as usize).ok_or_else(|| invalid("bad store type"))?;
+		let val_type = *TYPES.get(self.u8()? as usize).ok_or_else(|| invalid("bad value type"))?;
+		let value = self.str()?;
+		let ref_to = match self.u8()? {
+			0 => None,
+			_ => Some(Reference { to_ref_value: self.str()?, reference_range: self.range()? }),
+		};
+		let points_to = match self.u8()? {
+			0 => None,
+			_ => Some(Pointer { pointing_container: self.str()?, pointing_value: self.str()?, reference_range: self.range()? }),
+		};
+		let resolved = match self.u8()? {
+			0 => None,
+			_ => {
+				let container = self.u32()?;
+				let has_variable = self.u8()? != 0;
+				let variable = self.u32()?;
+				Some(Target { container, variable: if has_variable { Some(variable) } else { None } })
+			}
+		};
+		Ok(ListType { store_type, val_type, value, ref_to, points_to, resolved })
+	}
+}
+
+fn invalid(msg: &str) -> Error { Error::new(ErrorKind::InvalidData, msg) }
+
+///
+/// Profiles as they affect a parse: sorted, without duplicates
+///
+pub fn profile_set(profiles: &[String]) -> Vec<&str> {
+	let mut set: Vec<&str> = profiles.iter().map(String::as_str).collect();
+	set.sort_unstable();
+	set.dedup();
+	set
+}
+
+///
+/// Opt-in on-disk parse cache. Entries are named by the FNV-1a hash of the
+/// source (mixed with the active profiles) and the crate version, so edited
+/// files and upgrades never read stale entries. The source length, a second
+/// digest and the profile set are also stored in the entry and checked on load.
+/// The cache is best effort: a failed write still returns the parse
+///
+pub struct DiskCache {
+	dir: PathBuf,
+}
+
+impl DiskCache {
+	pub fn new(dir: &Path) -> Result<Self, Error> {
+		fs::create_dir_all(dir)?;
+		Ok(Self { dir: dir.to_path_buf() })
+	}
+
+	///
+	/// Load `path`, parsed and resolved, from the cache; parse and store it on a miss.
+	/// Documents with syntax errors are returned as errors and never stored
+	///
+	pub fn load(&self, path: &Path, profiles: &[String]) -> Result<RParser, Error> {
+		let source = {
+			let _span = crate::span!("read", path.display());
+			fs::read(path)?
+		};
+		self.load_bytes(source, profiles)
+	}
+
+	///
+	/// As `load`, for a document already in memory
+	///
+	pub fn load_bytes(&self, source: Vec<u8>, profiles: &[String]) -> Result<RParser, Error> {
+		let profiles = profile_set(profiles);
+		let mut id = SourceId::of(&source);
+		// Length-prefixed, so "prod" and "pr" + "od" differ
+		for profile in &profiles {
+			id.hash = fnv1a(id.hash, &(profile.len() as u64).to_le_bytes());
+			id.hash = fnv1a(id.hash, profile.as_bytes());
+		}
+
+		let entry = self.dir.join(format!("{:016x}-{}.vtcc", id.hash, VERSION));
+		if let Ok(data) = fs::read(&entry) {
+			if let Ok(parser) = decode(&data, id, &profiles) { return Ok(parser) }
+		}
+
+		let mut tokens = Tokens::from_vec(source)?;
+		if !profiles.is_empty() { tokens.set_profiles(&profiles); }
+		tokens.tokenize()?;
+		let mut parser = RParser::new(tokens);
+		parser.generate_ast();
+		if let Some(error) = parser.error() { return Err(invalid(error)) }
+		parser.resolve();
+
+		self.store(&entry, &encode(&parser, id, &profiles));
+		Ok(parser)
+	}
+
+	///
+	/// Write `data` to `entry` through a temporary name unique to this call, so concurrent
+	/// readers never see a partial entry. Failures only cost the next load a parse;
+	/// they are ignored and the temporary file is removed
+	///
+	fn store(&self, entry: &Path, data: &[u8]) {
+		static NEXT: AtomicU64 = AtomicU64::new(0);
+		let mut tmp = entry.as_os_str().to_owned();
+		tmp.push(format!(".{}-{}.tmp", std::process::id(), NEXT.fetch_add(1, Ordering::Relaxed)));
+		let tmp = PathBuf::from(tmp);
+		if fs::write(&tmp, data).and_then(|_| fs::rename(&tmp, entry)).is_err() {
+			let _ = fs::remove_file(&tmp);
+		}
+	}
+}
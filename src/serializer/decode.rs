@@ -0,0 +1,147 @@
+use crate::serializer::access::FromValue;
+use crate::serializer::parser::{PContainer, VarType};
+
+///
+/// Maps a container directly onto a struct. Implemented through `vtc_struct!`:
+/// ```
+/// # use vtc::serializer::{parser::RParser, token::Tokens};
+/// # use vtc::vtc_struct;
+/// vtc_struct! {
+///     #[derive(Debug)]
+///     pub struct Values<'a> {
+///         integers: Vec<i64>,
+///         strings: Vec<&'a str>,
+///         missing: Option<f64>,
+///     }
+/// }
+/// # let mut tokens = Tokens::from_text("@values:\n\t$integers := [1, 2]\n\t$strings := [\"a\"]\n");
+/// # tokens.tokenize().unwrap();
+/// # let mut parser = RParser::new(tokens);
+/// # parser.generate_ast();
+/// let values: Values = parser.decode("values").unwrap();
+/// assert_eq!(values.integers, [1, 2]);
+/// assert_eq!(values.strings, ["a"]);
+/// assert_eq!(values.missing, None);
+/// ```
+/// Field names match variable names. `&'a str` fields borrow from the document.
+///
+pub trait FromContainer<'a>: Sized {
+	fn from_container(container: &'a PContainer) -> Result<Self, DecodeErr>;
+}
+
+#[derive(Debug, PartialEq, Clone)]
+pub struct DecodeErr {
+	pub msg: String,
+}
+
+impl DecodeErr {
+	#[inline]
+	pub fn new(msg: String) -> Self { Self { msg } }
+}
+
+///
+/// Decodes one variable into a struct field
+/// * scalars read the first element
+/// * `Vec<T>` reads every element
+/// * `Option<T>` accepts a missing variable
+///
+pub trait FromVar<'a>: Sized {
+	fn from_var(value: &'a VarType) -> Option<Self>;
+
+	/// Value used when the container does not define the variable
+	#[inline]
+	fn missing() -> Option<Self> { None }
+}
+
+macro_rules! from_var_scalar {
+	($($t:ty),*) => {
+		$(impl<'a> FromVar<'a> for $t {
+			#[inline]
+			fn from_var(value: &'a VarType) -> Option<Self> {
+				match value {
+					VarType::List(values) => <$t as FromValue>::from_value(values.first()?),
+					VarType::EmptyList(_) => None,
+				}
+			}
+		})*
+	};
+}
+
+from_var_scalar!(i8, i16, i32, i64, u8, u16, u32, u64, f32, f64, bool, char, String, &'a str);
+
+impl<'a, T: FromValue<'a>> FromVar<'a> for Vec<T> {
+	#[inline]
+	fn from_var(value: &'a VarType) -> Option<Self> {
+		match value {
+			VarType::List(values) => values.iter().map(T::from_value).collect(),
+			VarType::EmptyList(_) => Some(vec![]),
+		}
+	}
+}
+
+impl<'a, T: FromVar<'a>> FromVar<'a> for Option<T> {
+	#[inline]
+	fn from_var(value: &'a VarType) -> Option<Self> { T::from_var(value).map(Some) }
+
+	#[inline]
+	fn missing() -> Option<Self> { Some(None) }
+}
+
+///
+/// Declares a struct and implements `FromContainer` for it.
+/// Variables are matched to fields in one pass over the container
+///
+#[macro_export]
+macro_rules! vtc_struct {
+	(
+		$(#[$meta:meta])*
+		$vis:vis struct $name:ident $(<$lt:lifetime>)? {
+			$($fvis:vis $field:ident : $ty:ty),* $(,)?
+		}
+	) => {
+		$(#[$meta])*
+		$vis struct $name $(<$lt>)? {
+			$($fvis $field: $ty),*
+		}
+
+		$crate::vtc_struct!(@impl $name [$($lt)?] $($field : $ty),*);
+	};
+
+	(@impl $name:ident [] $($field:ident : $ty:ty),*) => {
+		impl<'vtc> $crate::serializer::decode::FromContainer<'vtc> for $name {
+			$crate::vtc_struct!(@body 'vtc $($field : $ty),*);
+		}
+	};
+
+	(@impl $name:ident [$lt:lifetime] $($field:ident : $ty:ty),*) => {
+		impl<$lt> $crate::serializer::decode::FromContainer<$lt> for $name<$lt> {
+			$crate::vtc_struct!(@body $lt $($field : $ty),*);
+		}
+	};
+
+	(@body $lt:lifetime $($field:ident : $ty:ty),*) => {
+		fn from_container(container: &$lt $crate::serializer::parser::PContainer)
+			-> Result<Self, $crate::serializer::decode::DecodeErr> {
+			use $crate::serializer::decode::{DecodeErr, FromVar};
+
+			$(let mut $field: Option<$ty> = None;)*
+			for (name, value) in &container.values {
+				match name.as_str() {
+					$(stringify!($field) => {
+						$field = Some(<$ty as FromVar>::from_var(value).ok_or_else(|| DecodeErr::new(
+							format!("{}.{}: cannot decode as {}", container.c_name, name, stringify!($ty))))?);
+					})*
+					_ => {}
+				}
+			}
+
+			Ok(Self {
+				$($field: match $field {
+					Some(v) => v,
+					None => <$ty as FromVar>::missing().ok_or_else(|| DecodeErr::new(
+						format!("{}.{}: missing", container.c_name, stringify!($field))))?,
+				}),*
+			})
+		}
+	};
+}
@@ -0,0 +1,138 @@
+//! Cost attribution: parse time, resolve time and memory per `@container` and
+//! per `$variable`, with reference fan-out (references a container makes) and
+//! fan-in (references made to it).
+
+use std::fmt::Write as FmtWrite;
+use std::time::{Duration, Instant};
+use crate::serializer::memory;
+use crate::serializer::parser::{RParser, VarType};
+
+#[derive(Debug, Clone)]
+pub struct VarCost {
+	pub name: String,
+	pub parse: Duration,
+	pub values: usize,
+	pub heap_bytes: usize,
+	pub refs_out: usize,
+	pub refs_in: usize,
+}
+
+#[derive(Debug, Clone)]
+pub struct ContainerCost {
+	pub name: String,
+	pub parse: Duration,
+	pub resolve: Duration,
+	pub values: usize,
+	pub heap_bytes: usize,
+	pub refs_out: usize,
+	pub refs_in: usize,
+	pub vars: Vec<VarCost>,
+}
+
+impl ContainerCost {
+	#[inline]
+	pub fn total(&self) -> Duration { self.parse + self.resolve }
+}
+
+/// Costs in document order
+pub struct Report {
+	pub containers: Vec<ContainerCost>,
+}
+
+///
+/// Parse and resolve `parser` (a parser that has not generated its AST yet),
+/// timing each container and variable
+///
+pub fn explain(parser: &mut RParser) -> Report {
+	let timings = parser.generate_timed();
+
+	let mut containers: Vec<ContainerCost> = parser.containers().iter().zip(timings).map(|(container, (parse, var_times))| {
+		let vars: Vec<VarCost> = container.values.iter().zip(var_times).map(|((name, value), parse)| VarCost {
+			name: name.clone(),
+			parse,
+			values: match value { VarType::List(values) => values.len(), VarType::EmptyList(_) => 0 },
+			heap_bytes: memory::variable_bytes(name, value),
+			refs_out: 0,
+			refs_in: 0,
+		}).collect();
+		ContainerCost {
+			name: container.c_name.clone(),
+			parse,
+			resolve: Duration::ZERO,
+			values: vars.iter().map(|v| v.values).sum(),
+			heap_bytes: memory::container_bytes(container),
+			refs_out: 0,
+			refs_in: 0,
+			vars,
+		}
+	}).collect();
+
+	let mut targets = vec![];
+	for c_idx in 0..containers.len() {
+		let start = Instant::now();
+		parser.resolve_container(c_idx, &mut targets);
+		containers[c_idx].resolve = start.elapsed();
+	}
+
+	for (c_idx, container) in parser.containers().iter().enumerate() {
+		for (v_idx, (_, value)) in container.values.iter().enumerate() {
+			let values = match value {
+				VarType::List(values) => values,
+				VarType::EmptyList(_) => continue,
+			};
+			for value in values.iter().filter(|v| v.target_path().is_some()) {
+				containers[c_idx].refs_out += 1;
+				containers[c_idx].vars[v_idx].refs_out += 1;
+				if let Some(target) = value.resolved {
+					let target_c = &mut containers[target.container as usize];
+					target_c.refs_in += 1;
+					if let Some(target_v) = target.variable { target_c.vars[target_v as usize].refs_in += 1; }
+				}
+			}
+		}
+	}
+	Report { containers }
+}
+
+impl Report {
+	/// The `n` most expensive containers by parse + resolve time
+	pub fn top(&self, n: usize) -> Vec<&ContainerCost> {
+		let mut sorted: Vec<&ContainerCost> = self.containers.iter().collect();
+		sorted.sort_by(|a, b| b.total().cmp(&a.total()));
+		sorted.truncate(n);
+		sorted
+	}
+
+	/// The `n` most expensive variables by parse time, with their container
+	pub fn top_vars(&self, n: usize) -> Vec<(&ContainerCost, &VarCost)> {
+		let mut sorted: Vec<(&ContainerCost, &VarCost)> = self.containers.iter()
+			.flat_map(|c| c.vars.iter().map(move |v| (c, v)))
+			.collect();
+		sorted.sort_by(|a, b| b.1.parse.cmp(&a.1.parse));
+		sorted.truncate(n);
+		sorted
+	}
+
+	/// Top-`n` tables of containers and variables, with each row's share of the total
+	pub fn table(&self, n: usize) -> String {
+		let total: Duration = self.containers.iter().map(ContainerCost::total).sum();
+		let share = |d: Duration| 100.0 * d.as_secs_f64() / total.as_secs_f64().max(f64::MIN_POSITIVE);
+		let mut out = String::new();
+
+		writeln!(out, "{:<24} {:>12} {:>12} {:>7} {:>8} {:>10} {:>7} {:>7}",
+			"container", "parse", "resolve", "%", "values", "bytes", "refs>", "refs<").unwrap();
+		for c in self.top(n) {
+			writeln!(out, "{:<24} {:>12?} {:>12?} {:>6.1}% {:>8} {:>10} {:>7} {:>7}",
+				c.name, c.parse, c.resolve, share(c.total()), c.values, c.heap_bytes, c.refs_out, c.refs_in).unwrap();
+		}
+
+		writeln!(out).unwrap();
+		writeln!(out, "{:<36} {:>12} {:>7} {:>8} {:>10} {:>7} {:>7}",
+			"variable", "parse", "%", "values", "bytes", "refs>", "refs<").unwrap();
+		for (c, v) in self.top_vars(n) {
+			writeln!(out, "{:<36} {:>12?} {:>6.1}% {:>8} {:>10} {:>7} {:>7}",
+				format!("{}.{}", c.name, v.name), v.parse, share(v.parse), v.values, v.heap_bytes, v.refs_out, v.refs_in).unwrap();
+		}
+		out
+	}
+}
@@ -0,0 +1,220 @@
+//! Include resolution.
+//! `%%include <name>` (or `%%user <name>`, as in config/examples/include.vtc)
+//! pulls in `<name>.vtc` from the including file's directory. The include graph
+//! is loaded level by level, with each level's files parsed concurrently.
+//! Parsed files are kept in a process-wide cache keyed by canonical path and
+//! content hash, so a file shared by many documents is parsed once per process.
+//! A hit is used only if the cached source matches the bytes just read.
+//! The cache holds at most `MAX_CACHED` distinct files, dropping the oldest first;
+//! `cache_clear` empties it.
+
+use std::collections::{HashMap, HashSet, VecDeque};
+use std::fs;
+use std::io::{Error, ErrorKind};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::thread;
+use std::mem::size_of;
+use crate::serializer::access::hash_bytes;
+use crate::serializer::memory;
+use crate::serializer::parser::RParser;
+use crate::serializer::token::Tokens;
+
+/// Tag names that introduce an include
+const INCLUDE_TAGS: [&str; 2] = ["include", "user"];
+/// Distinct files (by contents) kept in the cache
+pub const MAX_CACHED: usize = 256;
+
+///
+/// Parsed, resolved file
+/// * path: canonical path
+/// * hash: FNV-1a hash of the file contents
+/// * includes: (include name, canonical path) in tag order
+///
+pub struct ParsedFile {
+	pub path: PathBuf,
+	pub hash: u64,
+	pub parser: RParser,
+	pub includes: Vec<(String, PathBuf)>,
+}
+
+#[derive(Default)]
+struct Cache {
+	by_path: HashMap<PathBuf, Arc<ParsedFile>>,
+	by_hash: HashMap<u64, Arc<ParsedFile>>,
+	/// Hashes in `by_hash`, oldest first
+	order: VecDeque<u64>,
+}
+
+impl Cache {
+	/// Cache `file`, read from `path`, dropping what it replaces and the oldest files past `MAX_CACHED`
+	fn insert(&mut self, path: &Path, file: &Arc<ParsedFile>) {
+		if let Some(old) = self.by_path.insert(path.to_path_buf(), file.clone()) {
+			// The previous contents of `path` stay only while another path has them
+			if old.hash != file.hash && !self.by_path.values().any(|f| f.hash == old.hash) {
+				self.by_hash.remove(&old.hash);
+				self.order.retain(|&hash| hash != old.hash);
+			}
+		}
+		if self.by_hash.contains_key(&file.hash) { return }
+		self.by_hash.insert(file.hash, file.clone());
+		self.order.push_back(file.hash);
+		while self.order.len() > MAX_CACHED {
+			let oldest = self.order.pop_front().unwrap();
+			self.by_hash.remove(&oldest);
+			self.by_path.retain(|_, f| f.hash != oldest);
+		}
+	}
+}
+
+fn cache() -> &'static Mutex<Cache> {
+	static CACHE: OnceLock<Mutex<Cache>> = OnceLock::new();
+	CACHE.get_or_init(|| Mutex::new(Cache::default()))
+}
+
+/// Drop every cached file
+pub fn cache_clear() {
+	let mut cache = cache().lock().unwrap();
+	cache.by_path.clear();
+	cache.by_hash.clear();
+	cache.order.clear();
+}
+
+/// Number of distinct parsed files held by the cache
+pub fn cache_len() -> usize {
+	cache().lock().unwrap().by_hash.len()
+}
+
+/// Bytes held by the cache: its parsed files and both lookup tables
+pub fn cache_memory() -> usize {
+	let cache = cache().lock().unwrap();
+	let files: usize = cache.by_hash.values().map(|file| {
+		size_of::<ParsedFile>() + file.path.capacity() + file.parser.memory_usage().total()
+			+ file.includes.capacity() * size_of::<(String, PathBuf)>()
+			+ file.includes.iter().map(|(name, path)| name.capacity() + path.capacity()).sum::<usize>()
+	}).sum();
+	let paths: usize = cache.by_path.keys().map(|path| path.capacity()).sum();
+	files + paths
+		+ memory::table_bytes::<PathBuf, Arc<ParsedFile>>(cache.by_path.capacity())
+		+ memory::table_bytes::<u64, Arc<ParsedFile>>(cache.by_hash.capacity())
+		+ cache.order.capacity() * size_of::<u64>()
+}
+
+///
+/// Loaded include graph. `files[0]` is the root document
+///
+pub struct IncludeGraph {
+	pub files: Vec<Arc<ParsedFile>>,
+	index: HashMap<PathBuf, usize>,
+}
+
+impl IncludeGraph {
+	/// Root document
+	pub fn root(&self) -> &ParsedFile {
+		&self.files[0]
+	}
+
+	/// File pulled in by `from` under the include `name`
+	pub fn include(&self, from: &ParsedFile, name: &str) -> Option<&ParsedFile> {
+		let (_, path) = from.includes.iter().find(|(n, _)| n == name)?;
+		Some(&self.files[*self.index.get(path)?])
+	}
+}
+
+///
+/// Load `path` and everything it includes, parsing up to `jobs` files concurrently
+///
+pub fn load(path: &Path, jobs: usize) -> Result<IncludeGraph, Error> {
+	let root = fs::canonicalize(path)?;
+	let mut graph = IncludeGraph { files: vec![], index: HashMap::new() };
+	let mut seen: HashSet<PathBuf> = HashSet::from([root.clone()]);
+	let mut frontier = vec![root];
+
+	while !frontier.is_empty() {
+		let loaded = {
+			let _span = crate::span!("include level", frontier.len());
+			load_level(&frontier, jobs.max(1))?
+		};
+
+		let mut next = vec![];
+		for (path, file) in frontier.iter().zip(loaded) {
+			for (_, include) in &file.includes {
+				if seen.insert(include.clone()) { next.push(include.clone()); }
+			}
+			// Keyed by the requested path: a cache hit by content may carry another path
+			graph.index.insert(path.clone(), graph.files.len());
+			graph.files.push(file);
+		}
+		frontier = next;
+	}
+	Ok(graph)
+}
+
+/// Load every path of one level of the include graph on up to `jobs` threads
+fn load_level(paths: &[PathBuf], jobs: usize) -> Result<Vec<Arc<ParsedFile>>, Error> {
+	let next = AtomicUsize::new(0);
+	let results: Vec<Mutex<Option<Result<Arc<ParsedFile>, Error>>>> = paths.iter().map(|_| Mutex::new(None)).collect();
+
+	thread::scope(|scope| {
+		for _ in 0..jobs.min(paths.len()) {
+			scope.spawn(|| loop {
+				let at = next.fetch_add(1, Ordering::Relaxed);
+				if at >= paths.len() { break }
+				*results[at].lock().unwrap() = Some(load_file(&paths[at]));
+			});
+		}
+	});
+
+	results.into_iter().map(|r| r.into_inner().unwrap().unwrap()).collect()
+}
+
+/// Load one canonical path through the process-wide cache. Files with syntax errors are not cached
+pub fn load_file(path: &Path) -> Result<Arc<ParsedFile>, Error> {
+	let _span = crate::span!("include", path.display());
+	let bytes = {
+		let _span = crate::span!("read", path.display());
+		fs::read(path)?
+	};
+	let hash = hash_bytes(&bytes);
+
+	{
+		// A matching hash is only a hint; the parse is reused when the bytes match too
+		let same = |file: &ParsedFile| file.hash == hash && file.parser.source().as_bytes() == bytes;
+		let mut cache = cache().lock().unwrap();
+		if let Some(file) = cache.by_path.get(path) {
+			if same(file) { return Ok(file.clone()) }
+		}
+		// Same contents under another path: reuse the parse
+		if let Some(file) = cache.by_hash.get(&hash).cloned() {
+			if file.path.parent() == path.parent() && same(&file) {
+				cache.insert(path, &file);
+				return Ok(file)
+			}
+		}
+	}
+
+	let data = String::from_utf8(bytes).map_err(|e| Error::new(ErrorKind::InvalidData, e))?;
+	let mut tokens = Tokens::from_data(data);
+	tokens.tokenize()?;
+	let mut parser = RParser::new(tokens);
+	parser.generate_ast();
+	if let Some(error) = parser.error() {
+		return Err(Error::new(ErrorKind::InvalidData, format!("{}: {}", path.display(), error)))
+	}
+	parser.resolve();
+
+	let dir = path.parent().unwrap_or(Path::new("."));
+	let mut includes = vec![];
+	for tag in parser.tags() {
+		if !INCLUDE_TAGS.contains(&tag.t_value_1.as_str()) { continue }
+		let include = dir.join(format!("{}.vtc", tag.t_value_2));
+		let include = fs::canonicalize(&include).map_err(|e| Error::new(e.kind(),
+			format!("{}: cannot include '{}': {}", path.display(), tag.t_value_2, e)))?;
+		includes.push((tag.t_value_2.clone(), include));
+	}
+
+	let file = Arc::new(ParsedFile { path: path.to_path_buf(), hash, parser, includes });
+	cache().lock().unwrap().insert(path, &file);
+	Ok(file)
+}
@@ -0,0 +1,139 @@
+//! Memory accounting for parsed documents.
+//! Sizes are exact for vectors and strings (by capacity, not length). Hash
+//! indexes are estimated from the standard library's table layout, assuming
+//! 16-byte control groups; tests/memory.rs checks totals against the allocator.
+
+use std::fmt;
+use std::mem::size_of;
+use crate::serializer::parser::{ListType, PContainer, Tag, VarType};
+use crate::serializer::types::Types;
+
+///
+/// Bytes held by a document
+/// * tokens: token vector and comment ranges
+/// * source: the source text literals point into
+/// * ast: container, variable and value structures, and resolve scratch
+/// * strings: names, string values and reference paths
+/// * numeric: text of numeric values
+/// * indexes: path hash indexes
+///
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct MemoryUsage {
+	pub tokens: usize,
+	pub source: usize,
+	pub ast: usize,
+	pub strings: usize,
+	pub numeric: usize,
+	pub indexes: usize,
+	pub containers: Vec<ContainerMemory>,
+}
+
+/// Bytes owned by one container; the container struct itself counts towards `MemoryUsage::ast`
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct ContainerMemory {
+	pub name: String,
+	pub ast: usize,
+	pub strings: usize,
+	pub numeric: usize,
+}
+
+impl ContainerMemory {
+	pub fn total(&self) -> usize { self.ast + self.strings + self.numeric }
+}
+
+impl MemoryUsage {
+	pub fn total(&self) -> usize {
+		self.tokens + self.source + self.ast + self.strings + self.numeric + self.indexes
+	}
+}
+
+impl fmt::Display for MemoryUsage {
+	fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+		writeln!(f, "tokens:  {:>12}", self.tokens)?;
+		writeln!(f, "source:  {:>12}", self.source)?;
+		writeln!(f, "ast:     {:>12}", self.ast)?;
+		writeln!(f, "strings: {:>12}", self.strings)?;
+		writeln!(f, "numeric: {:>12}", self.numeric)?;
+		writeln!(f, "indexes: {:>12}", self.indexes)?;
+		write!(f, "total:   {:>12}", self.total())
+	}
+}
+
+#[inline]
+fn is_numeric(val_type: Types) -> bool {
+	!matches!(val_type, Types::Char | Types::Str)
+}
+
+/// Account one value; its struct is counted by the owning list
+fn value(memory: &mut ContainerMemory, value: &ListType) {
+	match is_numeric(value.val_type) {
+		true => memory.numeric += value.value.capacity(),
+		false => memory.strings += value.value.capacity(),
+	}
+	if let Some(r) = &value.ref_to {
+		memory.strings += r.to_ref_value.capacity();
+		memory.ast += r.reference_range.capacity() * size_of::<u16>();
+	}
+	if let Some(p) = &value.points_to {
+		memory.strings += p.pointing_container.capacity() + p.pointing_value.capacity();
+		memory.ast += p.reference_range.capacity() * size_of::<u16>();
+	}
+}
+
+/// Account one variable, name included; its (name, value) slot is counted by the owning container
+fn variable(memory: &mut ContainerMemory, name: &String, var: &VarType) {
+	memory.strings += name.capacity();
+	match var {
+		VarType::EmptyList(ds_type) => memory.strings += ds_type.capacity(),
+		VarType::List(values) => {
+			memory.ast += values.capacity() * size_of::<ListType>();
+			for v in values { value(memory, v); }
+		}
+	}
+}
+
+/// Account everything `container` owns; the struct itself is counted by the document
+fn account(memory: &mut ContainerMemory, container: &PContainer) {
+	memory.strings += container.c_name.capacity();
+	memory.ast += container.values.capacity() * size_of::<(String, VarType)>();
+	for (name, var) in &container.values { variable(memory, name, var); }
+}
+
+pub(crate) fn container(container: &PContainer) -> ContainerMemory {
+	let mut memory = ContainerMemory { name: container.c_name.clone(), ..ContainerMemory::default() };
+	account(&mut memory, container);
+	memory
+}
+
+/// Heap bytes owned by `container`, as counted by `container`
+pub(crate) fn container_bytes(container: &PContainer) -> usize {
+	let mut memory = ContainerMemory::default();
+	account(&mut memory, container);
+	memory.total()
+}
+
+/// Heap bytes owned by the variable `name`, name included
+pub(crate) fn variable_bytes(name: &String, var: &VarType) -> usize {
+	let mut memory = ContainerMemory::default();
+	variable(&mut memory, name, var);
+	memory.total()
+}
+
+pub(crate) fn tags(tags: &Vec<Tag>) -> (usize, usize) {
+	let strings = tags.iter().map(|t| t.t_value_1.capacity() + t.t_value_2.capacity()).sum();
+	(tags.capacity() * size_of::<Tag>(), strings)
+}
+
+///
+/// Heap bytes of a std HashMap with `capacity` (as reported by `HashMap::capacity`):
+/// power-of-two buckets of (K, V) plus one control byte per bucket and a trailing group.
+/// An estimate: the group is 16 bytes with SSE2 and 8 on other targets
+///
+pub(crate) fn table_bytes<K, V>(capacity: usize) -> usize {
+	if capacity == 0 { return 0 }
+	let buckets = match capacity {
+		c if c < 8 => (c + 1).next_power_of_two(),
+		c => (c * 8 / 7).next_power_of_two(),
+	};
+	buckets * size_of::<(K, V)>() + buckets + 16
+}
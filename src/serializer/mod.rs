@@ -2,3 +2,15 @@
 pub mod token;
 pub mod types;
 pub mod parser;
+pub mod access;
+pub mod decode;
+pub mod schema;
+pub mod include;
+pub mod symbols;
+pub mod compiled;
+pub mod stats;
+pub mod explain;
+pub mod memory;
+pub mod stream;
+pub mod pool;
+pub mod reclaim;
@@ -1,7 +1,15 @@
+use std::collections::HashMap;
 use std::ffi::c_void;
 use std::fmt;
 use std::fmt::Formatter;
+use std::io::Error;
+use std::mem::size_of;
 use std::process::id;
+use std::time::{Duration, Instant};
+use crate::serializer::access::{hash_parts, hash_path, FromValue, Key, KeyIndex};
+use crate::serializer::decode::{DecodeErr, FromContainer};
+use crate::serializer::memory::{self, MemoryUsage};
+use crate::serializer::schema::{CompiledSchema, SchemaErr, Validator};
 use crate::serializer::token::LitKind;
 use crate::serializer::types::{Types, ValType};
 use crate::serializer::token::TokenKind::Literal;
@@ -9,7 +17,7 @@ use crate::serializer::token::{TokenKind, Tokens};
 use crate::Stack;
 
 #[derive(Debug)]
-struct Tag {
+pub struct Tag {
 	pub t_value_1: String,
 	pub t_value_2: String,
 }
@@ -24,37 +32,66 @@ impl Tag {
 }
 
 #[derive(Debug)]
-struct Reference {
+pub struct Reference {
 	pub to_ref_value: String,
 	pub reference_range: Vec<u16>
 }
 
 #[derive(Debug)]
-struct Pointer {
+pub struct Pointer {
 	pub pointing_container: String,
 	pub pointing_value: String,
 	pub reference_range: Vec<u16>
 }
 
+/// Location a Reference or Pointer resolves to
+/// * container: index into the parsed containers
+/// * variable: index of the variable inside the container; None selects the whole container
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct Target {
+	pub container: u32,
+	pub variable: Option<u32>,
+}
+
 /// ListType stores the bits and segments of the value such as
 /// Reference, Pointer, or by Value
 /// * store_type: Type of value stored within
 /// * val_type: Type of value i.e., string, float, integer, ...
 /// * ref_to: An optional field that defines what this value references to, if applicable
 /// * points_to: An optional field that defines what this value points to, if applicable
+/// * resolved: Target of `ref_to`/`points_to`, populated by `RParser::resolve`
 #[derive(Debug)]
-struct ListType {
+pub struct ListType {
 	pub store_type: ValType,
 	pub val_type: Types,
 	pub value: String,
 	pub ref_to: Option<Reference>,
 	pub points_to: Option<Pointer>,
+	pub resolved: Option<Target>,
+}
+
+impl ListType {
+	///
+	/// (container, variable) named by a Reference/Pointer as written; either may be empty.
+	/// None for plain values
+	///
+	#[inline]
+	pub fn target_path(&self) -> Option<(&str, &str)> {
+		match (&self.ref_to, &self.points_to) {
+			(Some(r), _) => Some(match r.to_ref_value.split_once('.') {
+				Some((c, v)) => (c, v),
+				None => ("", r.to_ref_value.as_str()),
+			}),
+			(_, Some(p)) => Some((p.pointing_container.as_str(), p.pointing_value.as_str())),
+			_ => None,
+		}
+	}
 }
 
 /// Annotate and store type of value a PValue field may contain
 /// All values inside the field has to be a list
 #[derive(Debug)]
-enum VarType {
+pub enum VarType {
 	EmptyList(String),
 	List(Vec<ListType>)
 }
@@ -65,7 +102,7 @@ enum VarType {
 /// * values: Intermediate representation of the values
 ///     - First field is for name of the variable
 ///     - Second field is for the contained value
-struct PContainer {
+pub struct PContainer {
 	pub c_name: String,
 	pub values: Vec<(String, VarType)>
 }
@@ -92,59 +129,384 @@ impl fmt::Debug for PContainer {
 pub struct RParser {
 	tag: Vec<Tag>,
 	p_container: Vec<PContainer>,
+	index: KeyIndex,
+	names: HashMap<u64, u32>,
 	tokens: Tokens,
 	cursor: usize,
+	error: Option<String>,
+	/// Resolve scratch, kept so reused parsers resolve without allocating
+	scratch: Vec<Option<Target>>,
 }
 
 impl RParser {
 	/// Constructs a new Root parser and populates with the tokens
 	pub fn new(tokens: Tokens) -> Self {
-		Self { tag: vec![], p_container: vec![], tokens, cursor: 0, }
+		Self { tag: vec![], p_container: vec![], index: KeyIndex::default(), names: HashMap::new(), tokens, cursor: 0, error: None, scratch: vec![] }
+	}
+
+	///
+	/// Drop the document, keeping the capacity of every buffer (tokens, source,
+	/// containers, indexes, scratch) for the next parse. Profiles are kept
+	///
+	pub fn reset(&mut self) {
+		self.tokens.reset("");
+		self.tag.clear();
+		self.p_container.clear();
+		self.index.clear();
+		self.names.clear();
+		self.cursor = 0;
+		self.error = None;
+	}
+
+	///
+	/// Tokenize and parse `data`, replacing the current document and reusing this
+	/// parser's buffers. Token errors are returned; syntax errors are kept as `error()`
+	///
+	pub fn parse_into(&mut self, data: &str) -> Result<(), Error> {
+		self.reset();
+		self.tokens.reset(data);
+		self.tokens.tokenize()?;
+		self.generate_ast();
+		Ok(())
+	}
+
+	/// Restrict tokenizing in `parse_into` to the active `profiles`; see `Tokens::set_profiles`
+	pub fn set_profiles(&mut self, profiles: &[&str]) {
+		self.tokens.set_profiles(profiles);
+	}
+
+	/// Tokenize every profile section again in `parse_into`
+	pub fn clear_profiles(&mut self) {
+		self.tokens.clear_profiles();
 	}
 
 	/// Generate a simple-AST
 	pub fn generate_ast(&mut self) {
-		let total_token_count = self.tokens.tokens().len();
-		let tokens = self.tokens.tokens();
+		self.generate(None, None);
+	}
 
-		if tokens.is_empty() { return; }
+	///
+	/// Generate the AST while running `schema` over each container as it is parsed.
+	/// Returns every schema violation; an empty vector means the document is valid
+	///
+	pub fn generate_ast_validated(&mut self, schema: &CompiledSchema) -> Vec<SchemaErr> {
+		let mut validator = Validator::new(schema);
+		self.generate(Some(&mut validator), None);
+		validator.finish()
+	}
 
-		let mut tags: Vec<Tag> = vec![];
+	///
+	/// Generate the AST, recording for each container its parse time and the parse
+	/// time of each of its variables, in document order
+	///
+	pub(crate) fn generate_timed(&mut self) -> Vec<(Duration, Vec<Duration>)> {
+		let mut timings = vec![];
+		self.generate(None, Some(&mut timings));
+		timings
+	}
+
+	fn generate(&mut self, validator: Option<&mut Validator>, timings: Option<&mut Vec<(Duration, Vec<Duration>)>>) {
+		let _span = crate::span!("parse");
+		// Moved out so the parser can be updated while the tokens are borrowed
+		let mut tokens = Tokens::from_data(String::new());
+		std::mem::swap(&mut tokens, &mut self.tokens);
+		self.generate_to(tokens.tokens(), tokens.source(), tokens.len(), validator, timings);
+		self.tokens = tokens;
+	}
+
+	///
+	/// Parse from the cursor up to token `end`, which must be the end of the tokens or
+	/// start a container or tag. Tokens past `end` are only looked at, never parsed, so a
+	/// document can be parsed piecewise while it is still being tokenized
+	///
+	pub(crate) fn generate_to(&mut self, tokens: &Vec<TokenKind>, src: &str, end: usize,
+		mut validator: Option<&mut Validator>, mut timings: Option<&mut Vec<(Duration, Vec<Duration>)>>) {
+		if self.cursor >= end || self.error.is_some() { return; }
+
+		let mut cursor = self.cursor;
+		let mut error = None;
+		// Parsed straight into the document, so reused parsers grow nothing
+		let first = self.p_container.len();
 		loop {
-			let c_tok = tokens.iter().nth(self.cursor).unwrap();
+			let c_tok = &tokens[cursor];
 
 			// Throw an error if starting token is not DbPerc | At
 			let index = match c_tok {
 				TokenKind::DbPerc => {
-					let (tag, idx) = Self::parse_tags(&tokens, &self.cursor);
-					tags.push(tag);
+					let (tag, idx) = Self::parse_tags(&tokens, src, &cursor);
+					if idx > 0 { self.tag.push(tag); }
 					idx
 				},
 				TokenKind::At => {
-					let (cont, idx) = Self::container_begin(&tokens, &self.cursor);
+					let _span = crate::span!("container", match Self::peek(&tokens, &cursor) {
+						Literal(v) => v.text(src),
+						_ => "",
+					});
+					let start = Instant::now();
+					let mut var_times = timings.as_ref().map(|_| vec![]);
+					let (cont, idx) = Self::container_begin(&tokens, src, &cursor, var_times.as_mut());
+					if let (Some(timings), Some(var_times)) = (timings.as_mut(), var_times) {
+						if idx > 0 { timings.push((start.elapsed(), var_times)); }
+					}
+					if idx > 0 {
+						if let Some(v) = validator.as_mut() { v.container(&cont); }
+						self.p_container.push(cont);
+					}
 					idx
 				},
-				TokenKind::Hash => (self.cursor + 1).try_into().unwrap(),
+				TokenKind::Hash => (cursor + 1).try_into().unwrap(),
 				_ => -1,
 			};
 
 			if index <= 0 {
-				// TODO: raise error
-				println!("Encountered issue parsing: {:?}", c_tok);
+				error = Some(format!("Encountered issue parsing: {:?} (token {})", c_tok, cursor));
 				break
 			}
-			self.cursor += index as usize;
+			cursor = index as usize;
+			if cursor >= end { break }
+		}
+
+		self.cursor = cursor;
+		self.error = error;
+		self.index_from(first);
+	}
+
+	///
+	/// Constructs a parser over already parsed tags and containers,
+	/// e.g. decoded from `compiled` form
+	///
+	pub fn from_parts(tags: Vec<Tag>, containers: Vec<PContainer>) -> Self {
+		let mut parser = Self::new(Tokens::from_data(String::new()));
+		parser.append(tags, containers);
+		parser
+	}
+
+	/// Append parsed tags/containers and index their paths
+	fn append(&mut self, mut tags: Vec<Tag>, mut containers: Vec<PContainer>) {
+		let first = self.p_container.len();
+		self.tag.append(&mut tags);
+		self.p_container.append(&mut containers);
+		self.index_from(first);
+	}
+
+	/// Index the paths of containers from `first` on
+	fn index_from(&mut self, first: usize) {
+		for (c_idx, container) in self.p_container.iter().enumerate().skip(first) {
+			self.names.insert(hash_path(&container.c_name), c_idx as u32);
+			for (v_idx, (name, _)) in container.values.iter().enumerate() {
+				let hash = hash_parts(&container.c_name, name);
+				self.index.insert(hash, (c_idx as u32, v_idx as u32));
+			}
+		}
+	}
+
+	///
+	/// Resolve every Reference/Pointer to the container/variable it names:
+	/// * <container>.<variable>
+	/// * <variable> within the current container, falling back to a <container> of that name
+	/// Returns the number of resolved values; unresolved values keep `resolved` as None
+	///
+	pub fn resolve(&mut self) -> usize {
+		let _span = crate::span!("resolve");
+		// Scratch shared by every variable, so resolving only allocates as it grows
+		let mut targets = std::mem::take(&mut self.scratch);
+		let count = (0..self.p_container.len()).map(|c_idx| self.resolve_container(c_idx, &mut targets)).sum();
+		targets.clear();
+		self.scratch = targets;
+		count
+	}
+
+	/// Resolve the references of one container; returns the number resolved
+	pub(crate) fn resolve_container(&mut self, c_idx: usize, targets: &mut Vec<Option<Target>>) -> usize {
+		let mut count = 0;
+		for v_idx in 0..self.p_container[c_idx].values.len() {
+			let current = &self.p_container[c_idx].c_name;
+			let target_of = |value: &ListType| -> Option<Target> {
+				let (container, variable) = value.target_path()?;
+				self.target(current, container, variable)
+			};
+
+			targets.clear();
+			match &self.p_container[c_idx].values[v_idx].1 {
+				VarType::List(values) => targets.extend(values.iter().map(target_of)),
+				VarType::EmptyList(_) => continue,
+			};
+			if let VarType::List(values) = &mut self.p_container[c_idx].values[v_idx].1 {
+				for (value, target) in values.iter_mut().zip(targets.drain(..)) {
+					if target.is_some() { count += 1; }
+					value.resolved = target;
+				}
+			}
+		}
+		count
+	}
+
+	///
+	/// Locate <container>.<variable> as written in a reference, relative to `current`.
+	/// An empty `container` names a variable of `current`, falling back to a container
+	/// named `variable`; an empty `variable` selects the whole container
+	///
+	pub fn target(&self, current: &str, container: &str, variable: &str) -> Option<Target> {
+		let lookup = |c: &str, v: &str| self.find(hash_parts(c, v), c, v)
+			.map(|(container, variable)| Target { container, variable: Some(variable) });
+		let whole = |c: &str| self.find_container(c)
+			.map(|container| Target { container, variable: None });
+		match (container, variable) {
+			("", v) => lookup(current, v).or_else(|| whole(v)),
+			(c, "") => whole(c),
+			(c, v) => lookup(c, v),
+		}
+	}
+
+	///
+	/// Index entry of <container>.<variable>. A hit is checked against the names, so a
+	/// colliding hash falls back to a scan instead of returning another variable
+	///
+	#[inline]
+	fn find(&self, hash: u64, container: &str, variable: &str) -> Option<(u32, u32)> {
+		let &(c_idx, v_idx) = self.index.get(&hash)?;
+		let found = &self.p_container[c_idx as usize];
+		if found.c_name == container && found.values[v_idx as usize].0 == variable { return Some((c_idx, v_idx)) }
+		// Later definitions win, as they do in the index
+		self.p_container.iter().enumerate().rev()
+			.filter(|(_, c)| c.c_name == container)
+			.find_map(|(c_idx, c)| c.values.iter().rposition(|(name, _)| name == variable)
+				.map(|v_idx| (c_idx as u32, v_idx as u32)))
+	}
+
+	/// Index of the container named `name`, checked against the name as in `find`
+	#[inline]
+	fn find_container(&self, name: &str) -> Option<u32> {
+		let &c_idx = self.names.get(&hash_path(name))?;
+		if self.p_container[c_idx as usize].c_name == name { return Some(c_idx) }
+		self.p_container.iter().rposition(|c| c.c_name == name).map(|c_idx| c_idx as u32)
+	}
+
+	/// Returns the container named `name`
+	#[inline]
+	pub fn container(&self, name: &str) -> Option<&PContainer> {
+		let c_idx = self.find_container(name)?;
+		Some(&self.p_container[c_idx as usize])
+	}
+
+	/// Decode container `name` into `T`, see `decode::FromContainer`
+	pub fn decode<'a, T: FromContainer<'a>>(&'a self, name: &str) -> Result<T, DecodeErr> {
+		match self.container(name) {
+			Some(container) => T::from_container(container),
+			None => Err(DecodeErr::new(format!("{}: no such container", name))),
+		}
+	}
+
+	///
+	/// Bytes held by this document, with a per-container breakdown
+	///
+	pub fn memory_usage(&self) -> MemoryUsage {
+		let (tokens, source) = self.tokens.heap_bytes();
+		let (tag_ast, tag_strings) = memory::tags(&self.tag);
+		let mut usage = MemoryUsage {
+			tokens,
+			source,
+			ast: tag_ast + self.p_container.capacity() * size_of::<PContainer>()
+				+ self.scratch.capacity() * size_of::<Option<Target>>(),
+			strings: tag_strings,
+			numeric: 0,
+			indexes: memory::table_bytes::<u64, (u32, u32)>(self.index.capacity())
+				+ memory::table_bytes::<u64, u32>(self.names.capacity()),
+			containers: Vec::with_capacity(self.p_container.len()),
+		};
+		for container in &self.p_container {
+			let c_usage = memory::container(container);
+			usage.ast += c_usage.ast;
+			usage.strings += c_usage.strings;
+			usage.numeric += c_usage.numeric;
+			usage.containers.push(c_usage);
+		}
+		usage
+	}
+
+	/// Syntax error that stopped the last `generate_ast`; containers before it are kept
+	pub fn error(&self) -> Option<&str> {
+		self.error.as_deref()
+	}
+
+	/// Text the document was parsed from
+	pub(crate) fn source(&self) -> &str {
+		self.tokens.source()
+	}
+
+	/// Replace the tokens the document was parsed from
+	pub(crate) fn set_tokens(&mut self, tokens: Tokens) {
+		self.tokens = tokens;
+	}
+
+	/// Returns parsed containers
+	pub fn containers(&self) -> &Vec<PContainer> {
+		&self.p_container
+	}
+
+	/// Returns parsed tags
+	pub fn tags(&self) -> &Vec<Tag> {
+		&self.tag
+	}
 
-			self.cursor += 1;
-			if self.cursor >= total_token_count { break }
+	/// Look up the value stored at `key` with a single probe into the path index
+	#[inline]
+	pub fn lookup(&self, key: Key) -> Option<&VarType> {
+		let (container, variable) = key.path.split_once('.')?;
+		let (c_idx, v_idx) = self.find(key.hash, container, variable)?;
+		Some(&self.p_container[c_idx as usize].values[v_idx as usize].1)
+	}
+
+	/// Look up the value stored at the dotted `path`, e.g. "values.integers"
+	#[inline]
+	pub fn lookup_path(&self, path: &str) -> Option<&VarType> {
+		let (container, variable) = path.split_once('.')?;
+		let (c_idx, v_idx) = self.find(hash_path(path), container, variable)?;
+		Some(&self.p_container[c_idx as usize].values[v_idx as usize].1)
+	}
+
+	///
+	/// Look up a value by its path hash alone, see `access::hash_path`. Without the path
+	/// a hash collision cannot be detected; prefer `lookup` or `lookup_path`
+	///
+	#[inline]
+	pub fn lookup_hash(&self, hash: u64) -> Option<&VarType> {
+		let &(c_idx, v_idx) = self.index.get(&hash)?;
+		let container = &self.p_container[c_idx as usize];
+		let (name, value) = &container.values[v_idx as usize];
+		debug_assert_eq!(hash_parts(&container.c_name, name), hash, "hash collision on {}.{}", container.c_name, name);
+		Some(value)
+	}
+
+	///
+	/// Read the first element stored at `key` as `T`.
+	/// Values are stored as text, so numeric `T` are parsed on every call; on hot paths
+	/// read once and keep the result, or decode the container into a struct (`decode`)
+	/// ```ignore
+	/// let size: i64 = parser.get(key!("example.ll_size")).unwrap();
+	/// ```
+	///
+	#[inline]
+	pub fn get<'a, T: FromValue<'a>>(&'a self, key: Key) -> Option<T> {
+		match self.lookup(key)? {
+			VarType::List(values) => T::from_value(values.first()?),
+			VarType::EmptyList(_) => None,
+		}
+	}
+
+	/// Read every element stored at `key` as `T`. Returns None if any element fails to decode
+	#[inline]
+	pub fn get_list<'a, T: FromValue<'a>>(&'a self, key: Key) -> Option<Vec<T>> {
+		match self.lookup(key)? {
+			VarType::List(values) => values.iter().map(T::from_value).collect(),
+			VarType::EmptyList(_) => Some(vec![]),
 		}
 	}
 
 	/// Peek through the next token value
 	#[inline]
 	fn peek<'a>(tokens: &'a Vec<TokenKind>, c_idx: &'a usize) -> &'a TokenKind {
-		let n_tok = tokens.iter().nth(c_idx + 1);
-		match n_tok {
+		match tokens.get(c_idx + 1) {
 			Some(v) => v,
 			None => &TokenKind::Blank
 		}
@@ -155,71 +517,233 @@ impl RParser {
 	/// Grammar: <@> + <String> + <:>
 	///     + <$> + <String> + <:=> + <[> + <ListValue> + <]>
 	#[inline]
-	fn container_begin(tokens: &Vec<TokenKind>, c_idx: &usize) -> (PContainer, i32) {
+	fn container_begin(tokens: &Vec<TokenKind>, src: &str, c_idx: &usize, mut var_times: Option<&mut Vec<Duration>>) -> (PContainer, i32) {
 		// We know that current index points to TokenKind::At
-		let mut w_idx = c_idx + 1;
+		let mut w_idx = *c_idx;
 		let t_size = tokens.len();
 		// Return error if index at next token == total size of token_kind
-		if w_idx >= t_size { return (PContainer::default(), -1) }
+		if w_idx + 1 >= t_size { return (PContainer::default(), -1) }
 		let mut t_container = PContainer::default();
 
 		// Extract container name:
 		let pk = Self::peek(&tokens, &w_idx);
 		let container_name = match pk {
-			TokenKind::Literal(v) => v.value.clone(),
+			TokenKind::Literal(v) => v.text(src).to_string(),
 			_ => String::new(),
 		};
-		println!("Container name: {}", container_name);
 		if container_name.is_empty() { return (t_container, -1) }
 		t_container.c_name = container_name;
 
 		w_idx += 1;
-		loop {
-			let w_tok = tokens.iter().nth(w_idx).unwrap();
-			match w_tok {
-				_ => {}
-			};
+		if *Self::peek(&tokens, &w_idx) != TokenKind::Col { return (t_container, -1) }
 
-			w_idx += 1;
-			if w_idx >= t_size { break }
+		w_idx += 2;
+		while w_idx < t_size {
+			match &tokens[w_idx] {
+				TokenKind::Hash => w_idx += 1,
+				TokenKind::Doll => {
+					let start = var_times.is_some().then(Instant::now);
+					let (name, value, idx) = Self::parse_variable(&tokens, src, &w_idx);
+					if idx <= 0 { return (t_container, -1) }
+					if let (Some(times), Some(start)) = (var_times.as_mut(), start) { times.push(start.elapsed()); }
+					t_container.values.push((name, value));
+					w_idx = idx as usize;
+				}
+				// Start of the next container or tag
+				TokenKind::At | TokenKind::DbPerc => break,
+				_ => return (t_container, -1),
+			}
 		}
 
-		println!("{:#?}", t_container);
 		(t_container, w_idx as i32)
 	}
 
+	/// Parse variable:
+	/// Grammar: <$> + <String> + <:=> + (<[> + <ListValue>* + <]> | <!> + <[> + <String> + <]> + <{> + <...> + <}> | <ListValue>)
+	#[inline]
+	fn parse_variable(tokens: &Vec<TokenKind>, src: &str, c_idx: &usize) -> (String, VarType, i32) {
+		let mut w_idx = *c_idx;
+		let empty = || (String::new(), VarType::List(vec![]), -1);
+
+		let name = match Self::peek(&tokens, &w_idx) {
+			Literal(v) => v.text(src).to_string(),
+			_ => return empty(),
+		};
+		w_idx += 1;
+		if *Self::peek(&tokens, &w_idx) != TokenKind::ColEq { return empty() }
+		w_idx += 2;
+
+		match tokens.get(w_idx) {
+			Some(TokenKind::LBrack) => {
+				w_idx += 1;
+				let mut values = vec![];
+				loop {
+					match tokens.get(w_idx) {
+						Some(TokenKind::RBrack) => break,
+						Some(TokenKind::Comma) | Some(TokenKind::Hash) => w_idx += 1,
+						Some(_) => {
+							let (value, idx) = Self::parse_list_value(&tokens, src, &w_idx);
+							if idx <= 0 { return empty() }
+							values.push(value);
+							w_idx = idx as usize;
+						}
+						None => return empty(),
+					}
+				}
+				(name, VarType::List(values), (w_idx + 1) as i32)
+			}
+			Some(TokenKind::Exclaim) => {
+				let expected = [TokenKind::LBrack, TokenKind::Blank, TokenKind::RBrack,
+					TokenKind::LCurl, TokenKind::TripDot, TokenKind::RCurl];
+				let mut ds_type = String::new();
+				for (offset, exp) in expected.iter().enumerate() {
+					match (tokens.get(w_idx + 1 + offset), exp) {
+						(Some(Literal(v)), TokenKind::Blank) => ds_type = v.text(src).to_string(),
+						(Some(tok), exp) if tok == exp => {},
+						_ => return empty(),
+					}
+				}
+				(name, VarType::EmptyList(ds_type), (w_idx + 1 + expected.len()) as i32)
+			}
+			Some(_) => {
+				let (value, idx) = Self::parse_list_value(&tokens, src, &w_idx);
+				if idx <= 0 { return empty() }
+				(name, VarType::List(vec![value]), idx)
+			}
+			None => empty(),
+		}
+	}
+
+	/// Parse a single list value:
+	/// Grammar: <Literal> + (<.> + <Literal>)? | (<&> | <%>) + <Path>
+	#[inline]
+	fn parse_list_value(tokens: &Vec<TokenKind>, src: &str, c_idx: &usize) -> (ListType, i32) {
+		let w_idx = *c_idx;
+		let mut list_value = ListType {
+			store_type: ValType::Value,
+			val_type: Types::Str,
+			value: String::new(),
+			ref_to: None,
+			points_to: None,
+			resolved: None,
+		};
+
+		match &tokens[w_idx] {
+			Literal(v) => {
+				// Tokenizer splits floats at the dot: <Int> + <.> + <Int>
+				if let (LitKind::Int, TokenKind::Dot, Some(Literal(frac))) =
+					(&v.kind, Self::peek(&tokens, &w_idx), tokens.get(w_idx + 2)) {
+					if frac.kind == LitKind::Int {
+						list_value.val_type = Types::Float64;
+						list_value.value = format!("{}.{}", v.text(src), frac.text(src));
+						return (list_value, (w_idx + 3) as i32)
+					}
+				}
+				list_value.val_type = match v.kind {
+					LitKind::Int => Types::I64,
+					LitKind::Float => Types::Float64,
+					_ => Types::Str,
+				};
+				list_value.value = v.text(src).to_string();
+				(list_value, (w_idx + 1) as i32)
+			}
+			TokenKind::Amp | TokenKind::Perc => {
+				let (segments, range, idx) = Self::parse_path(&tokens, src, &(w_idx + 1));
+				if idx <= 0 { return (list_value, -1) }
+				list_value.value = segments.join(".");
+				if tokens[w_idx] == TokenKind::Amp {
+					list_value.store_type = ValType::Ref;
+					list_value.ref_to = Some(Reference {
+						to_ref_value: list_value.value.clone(),
+						reference_range: range,
+					});
+				} else {
+					let (pointing_container, pointing_value) = match segments.len() {
+						1 => (String::new(), segments[0].to_string()),
+						_ => (segments[0].to_string(), segments[1..].join(".")),
+					};
+					list_value.store_type = ValType::Ptr;
+					list_value.points_to = Some(Pointer { pointing_container, pointing_value, reference_range: range });
+				}
+				(list_value, idx)
+			}
+			_ => (list_value, -1),
+		}
+	}
+
+	/// Parse path:
+	/// Grammar: <String> + (<.> + <String>)* + (<.>? + <[> + <Range> + <]> | <->> + (<Int> | <(> + <Range> + <)>))?
+	/// Returns the path segments and the range. An empty range selects every element
+	#[inline]
+	fn parse_path<'a>(tokens: &Vec<TokenKind>, src: &'a str, c_idx: &usize) -> (Vec<&'a str>, Vec<u16>, i32) {
+		let mut w_idx = *c_idx;
+		let mut segments = vec![];
+		let mut range = vec![];
+
+		loop {
+			match tokens.get(w_idx) {
+				Some(Literal(v)) => segments.push(v.text(src)),
+				_ => return (segments, range, -1),
+			}
+			w_idx += 1;
+			match (tokens.get(w_idx), tokens.get(w_idx + 1)) {
+				(Some(TokenKind::Dot), Some(Literal(_))) => w_idx += 1,
+				(Some(TokenKind::Dot), Some(TokenKind::LBrack)) => { w_idx += 1; break }
+				_ => break,
+			}
+		}
+
+		let close = match tokens.get(w_idx) {
+			Some(TokenKind::LBrack) => TokenKind::RBrack,
+			Some(TokenKind::DashGT) => match tokens.get(w_idx + 1) {
+				Some(TokenKind::LParen) => { w_idx += 1; TokenKind::RParen },
+				Some(Literal(v)) => match v.text(src).parse::<u16>() {
+					Ok(at) => return (segments, vec![at], (w_idx + 2) as i32),
+					Err(_) => return (segments, range, -1),
+				},
+				_ => return (segments, range, -1),
+			},
+			_ => return (segments, range, w_idx as i32),
+		};
+
+		w_idx += 1;
+		loop {
+			match tokens.get(w_idx) {
+				Some(Literal(v)) => match v.text(src).parse::<u16>() {
+					Ok(at) => range.push(at),
+					Err(_) => return (segments, range, -1),
+				},
+				Some(TokenKind::DbDot) => {},
+				Some(tok) if *tok == close => break,
+				_ => return (segments, range, -1),
+			}
+			w_idx += 1;
+		}
+		(segments, range, (w_idx + 1) as i32)
+	}
+
 	/// Parse tags:
 	/// %% foo bar ...
 	/// Grammar: <%%> + <String> + <String>
 	#[inline]
-	fn parse_tags(tokens: &Vec<TokenKind>, c_idx: &usize) -> (Tag, i32) {
+	fn parse_tags(tokens: &Vec<TokenKind>, src: &str, c_idx: &usize) -> (Tag, i32) {
 		let w_idx = c_idx + 1;
-		let in_range = c_idx + 2 <= tokens.len();
+		let in_range = c_idx + 2 < tokens.len();
 
 		// Early error
 		if !in_range { return (Tag::default(), -1) }
 
-		let mut lit_count = 0;
-		let mut tag_values = Vec::new();
-		loop {
-			let w_tok = tokens.iter().nth(w_idx).unwrap();
-			let value = match w_tok {
-				Literal(v) => v.value.clone(),
-				_ => "".to_string(),
-			};
-			// Failed first check
-			if value.is_empty() { return(Tag::default(), -1) }
-			println!("Tag_x :: {}", value);
-			tag_values.push(value);
-
-			lit_count += 1;
-			if lit_count == 2 { break }
-		}
-		assert_eq!(tag_values.len(), 2);
+		let text = |w_tok: &TokenKind| match w_tok {
+			Literal(v) => v.text(src),
+			_ => "",
+		};
+		let (value_1, value_2) = (text(&tokens[w_idx]), text(&tokens[w_idx + 1]));
+		// Failed first check
+		if value_1.is_empty() || value_2.is_empty() { return(Tag::default(), -1) }
 
 		let tag = Tag {
-			t_value_1: tag_values.iter().nth(0).unwrap().clone(),
-			t_value_2: tag_values.iter().nth(1).unwrap().clone(),
+			t_value_1: value_1.to_string(),
+			t_value_2: value_2.to_string(),
 		};
 
 		(tag, (w_idx + 2) as i32)
@@ -0,0 +1,74 @@
+//! Per-thread pools of reusable parsers, for services that parse many small
+//! documents. A pooled parser keeps its buffers between documents, so steady-state
+//! parsing only allocates for the parsed values themselves.
+//!
+//! ```ignore
+//! let doc = pool::parse(&text)?;
+//! let port = doc.get::<i64>(key!("server.port"));
+//! // `doc` goes back to this thread's pool when dropped
+//! ```
+
+use std::cell::RefCell;
+use std::io::Error;
+use std::ops::{Deref, DerefMut};
+use crate::serializer::parser::RParser;
+use crate::serializer::token::Tokens;
+
+/// Idle parsers kept per thread
+const MAX_POOLED: usize = 8;
+/// Parsers holding more than this after a reset are freed rather than pooled
+const MAX_RETAINED: usize = 1 << 20;
+
+thread_local! {
+	static PARSERS: RefCell<Vec<RParser>> = RefCell::new(vec![]);
+}
+
+/// A parser on loan from this thread's pool; reset and returned when dropped
+pub struct Pooled {
+	parser: Option<RParser>,
+}
+
+impl Deref for Pooled {
+	type Target = RParser;
+	fn deref(&self) -> &RParser { self.parser.as_ref().unwrap() }
+}
+
+impl DerefMut for Pooled {
+	fn deref_mut(&mut self) -> &mut RParser { self.parser.as_mut().unwrap() }
+}
+
+impl Drop for Pooled {
+	fn drop(&mut self) {
+		let mut parser = match self.parser.take() {
+			Some(parser) => parser,
+			None => return,
+		};
+		parser.reset();
+		parser.clear_profiles();
+		if parser.memory_usage().total() > MAX_RETAINED { return }
+		// The pool is gone while the thread exits; the parser is simply dropped then
+		let _ = PARSERS.try_with(|pool| {
+			let mut pool = pool.borrow_mut();
+			if pool.len() < MAX_POOLED { pool.push(parser); }
+		});
+	}
+}
+
+/// Take an empty parser from this thread's pool, or a new one if the pool is empty
+pub fn parser() -> Pooled {
+	let parser = PARSERS.try_with(|pool| pool.borrow_mut().pop()).ok().flatten()
+		.unwrap_or_else(|| RParser::new(Tokens::from_data(String::new())));
+	Pooled { parser: Some(parser) }
+}
+
+/// Tokenize and parse `data` on a pooled parser; see `RParser::parse_into`
+pub fn parse(data: &str) -> Result<Pooled, Error> {
+	let mut parser = parser();
+	parser.parse_into(data)?;
+	Ok(parser)
+}
+
+/// Parsers idle in this thread's pool
+pub fn idle() -> usize {
+	PARSERS.try_with(|pool| pool.borrow().len()).unwrap_or(0)
+}
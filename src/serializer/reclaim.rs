@@ -0,0 +1,84 @@
+//! Background reclamation of retired documents. Dropping a large document frees
+//! every container, variable and string it owns, which can take milliseconds;
+//! `retire` hands the value to a reclaimer thread instead, so the thread that
+//! swaps in a new document only pays for a channel send.
+//!
+//! ```ignore
+//! let old = std::mem::replace(&mut current, new_doc);
+//! reclaim::retire(old);
+//! ```
+
+use std::ops::{Deref, DerefMut};
+use std::sync::mpsc::{channel, sync_channel, Sender, SyncSender};
+use std::sync::{Mutex, OnceLock};
+use std::thread;
+
+enum Job {
+	Drop(Box<dyn Send>),
+	/// Acknowledged once every earlier job is done
+	Flush(SyncSender<()>),
+}
+
+/// Sender to the reclaimer thread, started on first use; None if it could not be spawned
+fn reclaimer() -> Option<Sender<Job>> {
+	static SENDER: OnceLock<Option<Mutex<Sender<Job>>>> = OnceLock::new();
+	let sender = SENDER.get_or_init(|| {
+		let (sender, jobs) = channel::<Job>();
+		thread::Builder::new().name("vtc-reclaim".to_string()).spawn(move || {
+			for job in jobs {
+				match job {
+					Job::Drop(value) => drop(value),
+					Job::Flush(done) => { let _ = done.send(()); },
+				}
+			}
+		}).ok()?;
+		Some(Mutex::new(sender))
+	});
+	sender.as_ref().map(|sender| sender.lock().unwrap().clone())
+}
+
+///
+/// Drop `value` on the reclaimer thread. Falls back to dropping it here if the
+/// thread cannot be started
+///
+pub fn retire<T: Send + 'static>(value: T) {
+	let job = Job::Drop(Box::new(value));
+	if let Some(Err(job)) = reclaimer().map(|sender| sender.send(job)) {
+		drop(job);
+	}
+}
+
+/// Wait until everything retired so far, from any thread, has been dropped
+pub fn flush() {
+	let (done, wait) = sync_channel(1);
+	if let Some(sender) = reclaimer() {
+		if sender.send(Job::Flush(done)).is_ok() { let _ = wait.recv(); }
+	}
+}
+
+/// Owns a value that is retired, rather than dropped in place, when the owner drops
+pub struct Deferred<T: Send + 'static> {
+	value: Option<T>,
+}
+
+impl<T: Send + 'static> Deferred<T> {
+	pub fn new(value: T) -> Self { Self { value: Some(value) } }
+
+	/// Take the value back; it is then dropped normally
+	pub fn into_inner(mut self) -> T { self.value.take().unwrap() }
+}
+
+impl<T: Send + 'static> Deref for Deferred<T> {
+	type Target = T;
+	fn deref(&self) -> &T { self.value.as_ref().unwrap() }
+}
+
+impl<T: Send + 'static> DerefMut for Deferred<T> {
+	fn deref_mut(&mut self) -> &mut T { self.value.as_mut().unwrap() }
+}
+
+impl<T: Send + 'static> Drop for Deferred<T> {
+	fn drop(&mut self) {
+		if let Some(value) = self.value.take() { retire(value); }
+	}
+}
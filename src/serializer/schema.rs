@@ -0,0 +1,377 @@
+use std::collections::{HashMap, HashSet};
+use crate::serializer::access::{hash_parts, hash_path};
+use crate::serializer::parser::{ListType, PContainer, VarType};
+use crate::serializer::types::{Types, ValType};
+
+///
+/// Schema declaration:
+/// ```ignore
+/// let schema = Schema::new()
+///     .container("values")
+///         .var("integers", Types::I32).len(1, 16)
+///         .var("referencing", Types::Str).refers_to("values")
+///     .container("example")
+///         .var("ll_size", Types::U32).optional()
+///     .compile();
+/// let errors = parser.generate_ast_validated(&schema);
+/// ```
+/// Builder calls apply to the last declared container/variable.
+///
+pub struct Schema {
+	containers: Vec<ContainerRule>,
+	deny_unknown: bool,
+}
+
+struct ContainerRule {
+	name: String,
+	required: bool,
+	vars: Vec<VarRule>,
+}
+
+struct VarRule {
+	name: String,
+	val_type: Types,
+	required: bool,
+	min_len: usize,
+	max_len: usize,
+	ref_target: Option<String>,
+}
+
+#[derive(Debug, PartialEq, Clone)]
+pub struct SchemaErr {
+	pub msg: String,
+}
+
+impl SchemaErr {
+	#[inline]
+	pub fn new(msg: String) -> Self { Self { msg } }
+}
+
+impl Schema {
+	pub fn new() -> Self {
+		Self { containers: vec![], deny_unknown: false }
+	}
+
+	/// Reject containers and variables the schema does not declare
+	pub fn deny_unknown(mut self) -> Self {
+		self.deny_unknown = true;
+		self
+	}
+
+	/// Declare a required container
+	pub fn container(mut self, name: &str) -> Self {
+		self.containers.push(ContainerRule { name: name.to_string(), required: true, vars: vec![] });
+		self
+	}
+
+	/// Declare a required variable whose values must decode as `val_type`
+	pub fn var(mut self, name: &str, val_type: Types) -> Self {
+		let container = self.containers.last_mut().expect("Schema::var called before Schema::container");
+		container.vars.push(VarRule {
+			name: name.to_string(), val_type, required: true, min_len: 0, max_len: usize::MAX, ref_target: None,
+		});
+		self
+	}
+
+	/// Mark the last variable, or the last container if it has none, as optional
+	pub fn optional(mut self) -> Self {
+		let container = self.containers.last_mut().expect("Schema::optional called before Schema::container");
+		match container.vars.last_mut() {
+			Some(var) => var.required = false,
+			None => container.required = false,
+		}
+		self
+	}
+
+	/// Bound the list length of the last variable (inclusive)
+	pub fn len(mut self, min: usize, max: usize) -> Self {
+		self.last_var().min_len = min;
+		self.last_var().max_len = max;
+		self
+	}
+
+	/// References/pointers in the last variable must target `target`: <container> or <container>.<variable>
+	pub fn refers_to(mut self, target: &str) -> Self {
+		self.last_var().ref_target = Some(target.to_string());
+		self
+	}
+
+	fn last_var(&mut self) -> &mut VarRule {
+		self.containers.last_mut().and_then(|c| c.vars.last_mut()).expect("Schema rule applied before Schema::var")
+	}
+
+	///
+	/// Compile into hash-indexed transition tables. Each parsed variable then
+	/// costs one probe plus the checks attached to its rule
+	///
+	pub fn compile(self) -> CompiledSchema {
+		let mut containers = HashMap::new();
+		let mut vars = HashMap::new();
+		let mut c_rules = vec![];
+		let mut v_rules = vec![];
+
+		for container in self.containers {
+			let first_var = v_rules.len() as u32;
+			for var in &container.vars {
+				vars.insert(hash_parts(&container.name, &var.name), v_rules.len() as u32);
+				let target = var.ref_target.as_ref().map(|t| match t.split_once('.') {
+					Some((c, v)) => (c.to_string(), Some(v.to_string())),
+					None => (t.clone(), None),
+				});
+				v_rules.push(CompiledVar {
+					path: format!("{}.{}", container.name, var.name),
+					container: container.name.len(),
+					check: value_check(var.val_type),
+					val_type: var.val_type,
+					required: var.required,
+					min_len: var.min_len,
+					max_len: var.max_len,
+					target,
+				});
+			}
+			containers.insert(hash_path(&container.name), c_rules.len() as u32);
+			c_rules.push(CompiledContainer {
+				name: container.name,
+				required: container.required,
+				first_var,
+				var_count: container.vars.len() as u32,
+			});
+		}
+
+		CompiledSchema { containers, vars, c_rules, v_rules, deny_unknown: self.deny_unknown }
+	}
+}
+
+struct CompiledContainer {
+	name: String,
+	required: bool,
+	first_var: u32,
+	var_count: u32,
+}
+
+struct CompiledVar {
+	/// <container>.<variable>
+	path: String,
+	/// Length of the container part of `path`
+	container: usize,
+	check: fn(&str) -> bool,
+	val_type: Types,
+	required: bool,
+	min_len: usize,
+	max_len: usize,
+	/// (container, optional variable) references must land on
+	target: Option<(String, Option<String>)>,
+}
+
+impl CompiledVar {
+	#[inline]
+	fn is(&self, container: &str, variable: &str) -> bool {
+		self.path.len() == container.len() + 1 + variable.len()
+			&& &self.path[..self.container] == container && &self.path[self.container + 1..] == variable
+	}
+}
+
+pub struct CompiledSchema {
+	containers: HashMap<u64, u32>,
+	vars: HashMap<u64, u32>,
+	c_rules: Vec<CompiledContainer>,
+	v_rules: Vec<CompiledVar>,
+	deny_unknown: bool,
+}
+
+impl CompiledSchema {
+	///
+	/// Rule of container `name`. A hit is checked against the name, so a colliding
+	/// hash falls back to a scan instead of applying another container's rule
+	///
+	fn container_rule(&self, name: &str) -> Option<u32> {
+		let &c_idx = self.containers.get(&hash_path(name))?;
+		if self.c_rules[c_idx as usize].name == name { return Some(c_idx) }
+		self.c_rules.iter().position(|c| c.name == name).map(|c_idx| c_idx as u32)
+	}
+
+	/// Rule of <container>.<variable>, checked against the names as in `container_rule`
+	fn var_rule(&self, container: &str, variable: &str) -> Option<u32> {
+		let &v_idx = self.vars.get(&hash_parts(container, variable))?;
+		if self.v_rules[v_idx as usize].is(container, variable) { return Some(v_idx) }
+		self.v_rules.iter().position(|v| v.is(container, variable)).map(|v_idx| v_idx as u32)
+	}
+}
+
+/// Literal check for each declared type, selected once at compile time
+fn value_check(val_type: Types) -> fn(&str) -> bool {
+	match val_type {
+		Types::I8 => |v| v.parse::<i8>().is_ok(),
+		Types::I16 => |v| v.parse::<i16>().is_ok(),
+		Types::I32 => |v| v.parse::<i32>().is_ok(),
+		Types::I64 => |v| v.parse::<i64>().is_ok(),
+		Types::U8 => |v| v.parse::<u8>().is_ok(),
+		Types::U16 => |v| v.parse::<u16>().is_ok(),
+		Types::U32 => |v| v.parse::<u32>().is_ok(),
+		Types::U64 => |v| v.parse::<u64>().is_ok(),
+		Types::Float32 => |v| v.parse::<f32>().is_ok(),
+		Types::Float8 | Types::Float16 | Types::Float64 | Types::Float128 => |v| v.parse::<f64>().is_ok(),
+		Types::Char => |v| v.chars().count() == 1,
+		Types::Str => |_| true,
+	}
+}
+
+///
+/// Validation state machine driven by parser events:
+/// enter_container -> variable* -> leave_container, ..., finish
+///
+pub struct Validator<'s> {
+	schema: &'s CompiledSchema,
+	/// Rule of the container being parsed, if the schema declares it
+	current: Option<u32>,
+	current_name: String,
+	seen_containers: Vec<bool>,
+	seen_vars: Vec<bool>,
+	/// Defined container names and <container>.<variable> paths, for reference targets
+	containers: HashSet<String>,
+	variables: HashSet<String>,
+	/// References checked in `finish`, once every target is known
+	pending_refs: Vec<PendingRef>,
+	errors: Vec<SchemaErr>,
+}
+
+impl<'s> Validator<'s> {
+	pub fn new(schema: &'s CompiledSchema) -> Self {
+		Self {
+			schema,
+			current: None,
+			current_name: String::new(),
+			seen_containers: vec![false; schema.c_rules.len()],
+			seen_vars: vec![false; schema.v_rules.len()],
+			containers: HashSet::new(),
+			variables: HashSet::new(),
+			pending_refs: vec![],
+			errors: vec![],
+		}
+	}
+
+	pub fn enter_container(&mut self, name: &str) {
+		self.current = self.schema.container_rule(name);
+		self.current_name.clear();
+		self.current_name.push_str(name);
+		self.containers.insert(name.to_string());
+
+		match self.current {
+			Some(c_idx) => self.seen_containers[c_idx as usize] = true,
+			None if self.schema.deny_unknown => self.error(format!("@{}: container is not declared in the schema", name)),
+			None => {}
+		}
+	}
+
+	pub fn variable(&mut self, name: &str, value: &VarType) {
+		self.variables.insert(format!("{}.{}", self.current_name, name));
+
+		let v_idx = match self.schema.var_rule(&self.current_name, name) {
+			Some(v_idx) => v_idx,
+			None => {
+				if self.schema.deny_unknown && self.current.is_some() {
+					self.error(format!("{}.{}: variable is not declared in the schema", self.current_name, name));
+				}
+				return
+			}
+		};
+		self.seen_vars[v_idx as usize] = true;
+		let rule = &self.schema.v_rules[v_idx as usize];
+
+		let values: &[ListType] = match value {
+			VarType::List(values) => values,
+			VarType::EmptyList(_) => &[],
+		};
+		if values.len() < rule.min_len || values.len() > rule.max_len {
+			self.error(format!("{}: expected {}..={} values, found {}", rule.path, rule.min_len, rule.max_len, values.len()));
+		}
+
+		for value in values {
+			match value.store_type {
+				ValType::Value => if !(rule.check)(&value.value) {
+					self.error(format!("{}: '{}' is not a valid {:?}", rule.path, value.value, rule.val_type));
+				},
+				ValType::Ref | ValType::Ptr => if rule.target.is_some() {
+					let (container, variable) = value.target_path().unwrap_or(("", ""));
+					self.pending_refs.push(PendingRef {
+						rule: v_idx,
+						current: self.current_name.clone(),
+						container: container.to_string(),
+						variable: variable.to_string(),
+						text: value.value.clone(),
+					});
+				},
+			}
+		}
+	}
+
+	pub fn leave_container(&mut self) {
+		self.current = None;
+	}
+
+	/// Check required declarations and reference targets, returning every error found
+	pub fn finish(mut self) -> Vec<SchemaErr> {
+		for (c_idx, rule) in self.schema.c_rules.iter().enumerate() {
+			if !self.seen_containers[c_idx] {
+				if rule.required { self.errors.push(SchemaErr::new(format!("@{}: required container is missing", rule.name))); }
+				continue
+			}
+			for v_idx in rule.first_var..rule.first_var + rule.var_count {
+				let var = &self.schema.v_rules[v_idx as usize];
+				if var.required && !self.seen_vars[v_idx as usize] {
+					self.errors.push(SchemaErr::new(format!("{}: required variable is missing", var.path)));
+				}
+			}
+		}
+
+		for pending in &self.pending_refs {
+			let rule = &self.schema.v_rules[pending.rule as usize];
+			let (target_c, target_v) = rule.target.as_ref().unwrap();
+			match self.target(pending) {
+				None => self.errors.push(SchemaErr::new(format!("{}: reference target does not exist", rule.path))),
+				Some((c, v)) if c != target_c || target_v.as_ref().map_or(false, |t| Some(t.as_str()) != v) =>
+					self.errors.push(SchemaErr::new(format!("{}: reference '{}' is outside of its allowed target", rule.path, pending.text))),
+				Some(_) => {}
+			}
+		}
+		self.errors
+	}
+
+	/// Run the state machine over an already parsed container
+	pub fn container(&mut self, container: &PContainer) {
+		self.enter_container(&container.c_name);
+		for (name, value) in &container.values {
+			self.variable(name, value);
+		}
+		self.leave_container();
+	}
+
+	///
+	/// Container/variable a reference lands on, by the rule of `RParser::target`:
+	/// an empty container names a variable of the current container, falling back
+	/// to a container named after the variable; an empty variable selects the whole container
+	///
+	fn target<'a>(&self, pending: &'a PendingRef) -> Option<(&'a str, Option<&'a str>)> {
+		let lookup = |c: &'a str, v: &'a str| self.variables.contains(&format!("{}.{}", c, v)).then(|| (c, Some(v)));
+		let whole = |c: &'a str| self.containers.contains(c).then(|| (c, None));
+		match (pending.container.as_str(), pending.variable.as_str()) {
+			("", v) => lookup(&pending.current, v).or_else(|| whole(v)),
+			(c, "") => whole(c),
+			(c, v) => lookup(c, v),
+		}
+	}
+
+	fn error(&mut self, msg: String) {
+		self.errors.push(SchemaErr::new(msg));
+	}
+}
+
+/// Reference met while parsing, with the container it appeared in
+struct PendingRef {
+	rule: u32,
+	current: String,
+	container: String,
+	variable: String,
+	/// As written, for error messages
+	text: String,
+}
@@ -0,0 +1,148 @@
+//! Per-phase cost of loading a document: wall time, allocations and peak
+//! memory per phase, plus what each phase produced.
+//! Allocation columns need `alloc::CountingAlloc` installed as the global allocator
+//! and `alloc::enable_counting` called.
+
+use std::collections::BTreeMap;
+use std::fmt;
+use std::fs::File;
+use std::io::{Error, Read};
+use std::time::{Duration, Instant};
+use crate::alloc::{self, AllocSnapshot};
+use crate::serializer::memory::MemoryUsage;
+use crate::serializer::parser::{RParser, VarType};
+use crate::serializer::token::Tokens;
+use crate::serializer::types::ValType;
+
+///
+/// One timed phase
+/// * alloc: allocations made during the phase; `peak` is the highest live byte count reached in it
+///
+#[derive(Debug, Clone)]
+pub struct PhaseStats {
+	pub name: &'static str,
+	pub wall: Duration,
+	pub alloc: AllocSnapshot,
+}
+
+#[derive(Debug, Clone, Default)]
+pub struct Stats {
+	pub phases: Vec<PhaseStats>,
+	pub bytes_read: usize,
+	/// Token count by kind name
+	pub tokens: BTreeMap<&'static str, usize>,
+	pub containers: usize,
+	pub values: usize,
+	/// References and pointers
+	pub refs: usize,
+	pub resolved: usize,
+	pub memory: MemoryUsage,
+}
+
+impl Stats {
+	pub fn new() -> Self { Self::default() }
+
+	/// Run `f` as phase `name`
+	pub fn phase<T>(&mut self, name: &'static str, f: impl FnOnce() -> T) -> T {
+		alloc::reset_peak();
+		let before = alloc::snapshot();
+		let start = Instant::now();
+		let value = f();
+		let wall = start.elapsed();
+		self.phases.push(PhaseStats { name, wall, alloc: alloc::snapshot().since(&before) });
+		value
+	}
+
+	pub fn count_tokens(&mut self, tokens: &Tokens) {
+		for token in tokens.tokens() {
+			*self.tokens.entry(token.name()).or_insert(0) += 1;
+		}
+	}
+
+	/// Count containers, values, references and memory of a parsed (and possibly resolved) document
+	pub fn count_document(&mut self, parser: &RParser) {
+		self.memory = parser.memory_usage();
+		self.containers = parser.containers().len();
+		self.values = 0;
+		self.refs = 0;
+		self.resolved = 0;
+		for container in parser.containers() {
+			for (_, value) in &container.values {
+				let values = match value {
+					VarType::List(values) => values,
+					VarType::EmptyList(_) => continue,
+				};
+				self.values += values.len();
+				for value in values {
+					if value.store_type != ValType::Value { self.refs += 1; }
+					if value.resolved.is_some() { self.resolved += 1; }
+				}
+			}
+		}
+	}
+
+	pub fn total(&self) -> Duration {
+		self.phases.iter().map(|p| p.wall).sum()
+	}
+}
+
+impl fmt::Display for Stats {
+	fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+		let counted = alloc::installed();
+		writeln!(f, "{:<10} {:>12} {:>10} {:>12} {:>12}", "phase", "wall", "allocs", "alloc bytes", "peak")?;
+		for phase in &self.phases {
+			write!(f, "{:<10} {:>12?}", phase.name, phase.wall)?;
+			match counted {
+				true => writeln!(f, " {:>10} {:>12} {:>12}", phase.alloc.allocs, phase.alloc.bytes, phase.alloc.peak)?,
+				false => writeln!(f, " {:>10} {:>12} {:>12}", "-", "-", "-")?,
+			}
+		}
+		writeln!(f, "{:<10} {:>12?}", "total", self.total())?;
+		writeln!(f)?;
+		writeln!(f, "bytes read: {}", self.bytes_read)?;
+		let token_total: usize = self.tokens.values().sum();
+		let by_kind: Vec<String> = self.tokens.iter().map(|(kind, count)| format!("{} {}", kind, count)).collect();
+		writeln!(f, "tokens: {} ({})", token_total, by_kind.join(", "))?;
+		writeln!(f, "containers: {}", self.containers)?;
+		writeln!(f, "values: {}", self.values)?;
+		writeln!(f, "references: {} ({} resolved)", self.refs, self.resolved)?;
+		let memory = &self.memory;
+		write!(f, "memory: {} (tokens {}, source {}, ast {}, strings {}, numeric {}, indexes {})", memory.total(),
+			memory.tokens, memory.source, memory.ast, memory.strings, memory.numeric, memory.indexes)
+	}
+}
+
+///
+/// Read, tokenize, parse and resolve `path`, timing each phase
+///
+pub fn load(path: &str, profiles: &[String]) -> Result<(RParser, Stats), Error> {
+	let _span = crate::span!("open", path);
+	load_reader(File::open(path)?, profiles)
+}
+
+///
+/// As `load`, over everything `reader` yields
+///
+pub fn load_reader(mut reader: impl Read, profiles: &[String]) -> Result<(RParser, Stats), Error> {
+	let mut stats = Stats::new();
+
+	let data = stats.phase("read", || {
+		let _span = crate::span!("read");
+		let mut data = String::new();
+		reader.read_to_string(&mut data).map(|_| data)
+	})?;
+	stats.bytes_read = data.len();
+
+	let mut tokens = Tokens::from_data(data);
+	if !profiles.is_empty() {
+		tokens.set_profiles(&profiles.iter().map(String::as_str).collect::<Vec<_>>());
+	}
+	stats.phase("lex", || tokens.tokenize())?;
+	stats.count_tokens(&tokens);
+
+	let mut parser = RParser::new(tokens);
+	stats.phase("parse", || parser.generate_ast());
+	stats.phase("resolve", || parser.resolve());
+	stats.count_document(&parser);
+	Ok((parser, stats))
+}
@@ -0,0 +1,70 @@
+//! Overlapped loading of one document: the tokenizer runs on its own thread and
+//! hands tokens to the parser in batches through a lock-free SPSC ring
+//! (`crate::ring`), so a large document is parsed while it is still being lexed.
+//! The result is the same as `tokenize` followed by `generate_ast`.
+
+use std::io::Error;
+use std::thread;
+use crate::ring;
+use crate::serializer::parser::RParser;
+use crate::serializer::token::{TokenKind, Tokens};
+
+/// Tokens per published batch
+const BATCH: usize = 512;
+/// Tokens in flight between the threads
+const CAPACITY: usize = 64 * 1024;
+/// Tokens that must follow a container boundary before what precedes it is parsed; covers parser lookahead
+const LOOKAHEAD: usize = 4;
+
+///
+/// Tokenize and parse `tokens` (as returned by `Tokens::new`, profiles set, not yet
+/// tokenized) with lexing and parsing overlapped. Token errors are returned;
+/// syntax errors are recorded on the parser as with `generate_ast`
+///
+pub fn parse(mut tokens: Tokens) -> Result<RParser, Error> {
+	// With one CPU the threads would only take turns
+	if thread::available_parallelism().map_or(1, |n| n.get()) < 2 {
+		tokens.tokenize()?;
+		let mut parser = RParser::new(tokens);
+		parser.generate_ast();
+		return Ok(parser)
+	}
+
+	let data = tokens.take_source();
+	let (mut producer, consumer) = ring::channel::<TokenKind>(CAPACITY, BATCH);
+	let mut parser = RParser::new(Tokens::from_data(String::new()));
+	let mut parsed: Vec<TokenKind> = vec![];
+
+	let lexed = thread::scope(|scope| {
+		let (lexer, data) = (&mut tokens, data.as_str());
+		let lexing = scope.spawn(move || {
+			// Tokens pushed after the parser has gone are dropped; its panic surfaces from the scope
+			let result = lexer.lex(data, |token| { let _ = producer.push(token); });
+			drop(producer);
+			result
+		});
+
+		// Owned by this closure so a panicking parser drops it while unwinding, before the
+		// scope joins the lexer; a lexer waiting on a full ring then sees it closed
+		let mut consumer = consumer;
+		let _span = crate::span!("parse");
+		// Everything before the last boundary (a container or tag start) seen can be parsed
+		let (mut scanned, mut end) = (0, 0);
+		while consumer.pop_into(&mut parsed) {
+			let ready = (parsed.len() + 1).saturating_sub(LOOKAHEAD);
+			for at in scanned..ready {
+				if matches!(parsed[at], TokenKind::At | TokenKind::DbPerc) { end = at; }
+			}
+			scanned = scanned.max(ready);
+			parser.generate_to(&parsed, data, end, None, None);
+		}
+		parser.generate_to(&parsed, data, parsed.len(), None, None);
+		lexing.join().unwrap()
+	});
+
+	// A token error takes precedence over syntax errors, as when tokenizing first
+	lexed?;
+	tokens.restore(data, parsed);
+	parser.set_tokens(tokens);
+	Ok(parser)
+}
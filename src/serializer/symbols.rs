@@ -0,0 +1,130 @@
+//! Cross-file symbol table.
+//! Files are registered with a cheap line scan that records their `@container`
+//! and `$variable` names without tokenizing values. A file is parsed only when
+//! one of its symbols is dereferenced; parses go through the shared include cache.
+
+use std::collections::HashMap;
+use std::fs;
+use std::io::{Error, ErrorKind};
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex};
+use crate::serializer::access::{hash_parts, hash_path};
+use crate::serializer::include::{self, ParsedFile};
+use crate::serializer::parser::{ListType, Target};
+
+struct LazyFile {
+	path: PathBuf,
+	loaded: Mutex<Option<Arc<ParsedFile>>>,
+}
+
+pub struct SymbolTable {
+	files: Vec<LazyFile>,
+	/// Container name hash -> file
+	containers: HashMap<u64, u32>,
+	/// <container>.<variable> hash -> file
+	vars: HashMap<u64, u32>,
+}
+
+impl SymbolTable {
+	pub fn new() -> Self {
+		Self { files: vec![], containers: HashMap::new(), vars: HashMap::new() }
+	}
+
+	///
+	/// Register the symbols defined by `path`. Only container and variable names are read;
+	/// a symbol defined by several files resolves to the last one registered. Registering
+	/// a file again replaces its symbols and drops its parse
+	///
+	pub fn add_file(&mut self, path: &Path) -> Result<(), Error> {
+		let path = fs::canonicalize(path)?;
+		let data = fs::read_to_string(&path)?;
+		let file_idx = match self.files.iter().position(|f| f.path == path) {
+			Some(at) => {
+				let at = at as u32;
+				self.containers.retain(|_, &mut idx| idx != at);
+				self.vars.retain(|_, &mut idx| idx != at);
+				*self.files[at as usize].loaded.lock().unwrap() = None;
+				at
+			},
+			None => {
+				self.files.push(LazyFile { path, loaded: Mutex::new(None) });
+				self.files.len() as u32 - 1
+			},
+		};
+
+		let mut current: Option<&str> = None;
+		for line in data.lines() {
+			let line = line.trim_start();
+			if let Some(rest) = line.strip_prefix('@') {
+				let name = rest.split(|c: char| c == ':' || c.is_whitespace()).next().unwrap_or("");
+				self.containers.insert(hash_path(name), file_idx);
+				current = Some(name);
+			} else if let (Some(rest), Some(container)) = (line.strip_prefix('$'), current) {
+				let name = rest.split(|c: char| c == ':' || c.is_whitespace()).next().unwrap_or("");
+				self.vars.insert(hash_parts(container, name), file_idx);
+			}
+		}
+		Ok(())
+	}
+
+	/// Register every `.vtc` file directly inside `dir`; subdirectories are not searched
+	pub fn add_dir(&mut self, dir: &Path) -> Result<usize, Error> {
+		let mut paths: Vec<PathBuf> = fs::read_dir(dir)?
+			.filter_map(|e| e.ok().map(|e| e.path()))
+			.filter(|p| p.extension().map_or(false, |e| e == "vtc") && p.is_file())
+			.collect();
+		paths.sort();
+		for path in &paths { self.add_file(path)?; }
+		Ok(paths.len())
+	}
+
+	/// File that defines `container`, without loading it
+	pub fn file_of(&self, container: &str) -> Option<&Path> {
+		let &file_idx = self.containers.get(&hash_path(container))?;
+		Some(&self.files[file_idx as usize].path)
+	}
+
+	/// Number of registered files that have been parsed
+	pub fn loaded_count(&self) -> usize {
+		self.files.iter().filter(|f| f.loaded.lock().unwrap().is_some()).count()
+	}
+
+	///
+	/// Load the file defining <container>.<variable> (or the whole container when
+	/// `variable` is empty) and locate the symbol in it
+	///
+	pub fn lookup(&self, container: &str, variable: &str) -> Result<Option<(Arc<ParsedFile>, Target)>, Error> {
+		let file_idx = match variable {
+			"" => self.containers.get(&hash_path(container)),
+			v => self.vars.get(&hash_parts(container, v)),
+		};
+		let file = match file_idx {
+			Some(&idx) => self.load(idx)?,
+			None => return Ok(None),
+		};
+		let target = file.parser.target("", container, variable);
+		Ok(target.map(|t| (file, t)))
+	}
+
+	///
+	/// Dereference a Reference/Pointer that its own document could not resolve.
+	/// Single-segment paths name a container in another file
+	///
+	pub fn deref(&self, value: &ListType) -> Result<Option<(Arc<ParsedFile>, Target)>, Error> {
+		match value.target_path() {
+			Some(("", name)) => self.lookup(name, ""),
+			Some((container, variable)) => self.lookup(container, variable),
+			None => Err(Error::new(ErrorKind::InvalidInput, format!("'{}' is not a reference", value.value))),
+		}
+	}
+
+	fn load(&self, file_idx: u32) -> Result<Arc<ParsedFile>, Error> {
+		let lazy = &self.files[file_idx as usize];
+		let mut loaded = lazy.loaded.lock().unwrap();
+		if let Some(file) = loaded.as_ref() { return Ok(file.clone()) }
+
+		let file = include::load_file(&lazy.path)?;
+		*loaded = Some(file.clone());
+		Ok(file)
+	}
+}
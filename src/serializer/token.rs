@@ -1,15 +1,21 @@
 use std::fmt;
 use std::fs::File;
 use std::fmt::Formatter;
-use std::io::{Error, Read};
+use std::io::{Error, ErrorKind, Read};
+use std::mem::size_of;
 
+/// Byte-indexed: the grammar is ASCII, and `chars().nth` made every lookup O(n)
 #[inline]
-fn str_peek(buff: &String, c_idx: &usize) -> char {
-	let next = match buff.chars().nth(c_idx + 1) {
-		Some(value) => value,
+fn str_at(buff: &str, c_idx: usize) -> char {
+	match buff.as_bytes().get(c_idx) {
+		Some(value) => *value as char,
 		None => '\0'
-	};
-	next
+	}
+}
+
+#[inline]
+fn str_peek(buff: &str, c_idx: &usize) -> char {
+	str_at(buff, c_idx + 1)
 }
 
 #[inline]
@@ -60,10 +66,12 @@ impl fmt::Debug for LitKind {
 	}
 }
 
+/// Literal; `start`/`len` locate its text in the tokenized source (see `Tokens::text`)
 #[derive(PartialEq, Clone)]
 pub struct Lit {
 	pub kind: LitKind,
-	pub value: String
+	pub start: u32,
+	pub len: u32,
 }
 
 #[derive(PartialEq, Clone)]
@@ -78,8 +86,14 @@ impl TokErr {
 }
 
 impl Lit {
-	pub fn new(kind: LitKind, value: String) -> Self {
-		Self { kind, value }
+	pub fn new(kind: LitKind, start: u32, len: u32) -> Self {
+		Self { kind, start, len }
+	}
+
+	/// Text of the literal within `src`, the data it was tokenized from
+	#[inline]
+	pub fn text<'a>(&self, src: &'a str) -> &'a str {
+		&src[self.start as usize..(self.start + self.len) as usize]
 	}
 }
 
@@ -111,9 +125,10 @@ pub enum TokenKind {
 	EOF,
 }
 
-impl fmt::Debug for TokenKind {
-	fn fmt(&self, f: &mut Formatter<'_>) -> fmt::Result {
-		let w_value = match *self {
+impl TokenKind {
+	/// Kind name without the literal/error payload
+	pub fn name(&self) -> &'static str {
+		match *self {
 			TokenKind::At       => {"At"},
 			TokenKind::Amp      => {"Amp"},
 			TokenKind::Col      => {"Col"},
@@ -138,15 +153,22 @@ impl fmt::Debug for TokenKind {
 			TokenKind::Err(_)   => {"Err"},
 			TokenKind::EOF      => {"EOF"},
 			TokenKind::Literal(_) => {"Literal"},
-		};
-		write!(f, "{}", w_value)
+		}
+	}
+}
+
+impl fmt::Debug for TokenKind {
+	fn fmt(&self, f: &mut Formatter<'_>) -> fmt::Result {
+		write!(f, "{}", self.name())
 	}
 }
 
 pub struct Tokens {
 	file_data:  String,
 	tokens:     Vec<TokenKind>,
-	data:       Vec<String>
+	/// Byte ranges of comments, '#' included
+	comments:   Vec<(u32, u32)>,
+	profiles:   Option<Vec<String>>,
 }
 
 impl Tokens {
@@ -154,14 +176,55 @@ impl Tokens {
 	/// Initialize empty token list and read file data
 	///
 	pub fn new(filename: &str) -> Result<Self, Error> {
+		let _span = crate::span!("read", filename);
+		Self::from_reader(File::open(filename)?)
+	}
+
+	/// Initialize empty token list over data that is already in memory
+	pub fn from_data(file_data: String) -> Self {
+		let tokens = vec![];
+		let comments = vec![];
+		Self { file_data, tokens, comments, profiles: None }
+	}
+
+	/// Initialize over a copy of `data`
+	pub fn from_text(data: &str) -> Self {
+		Self::from_data(data.to_string())
+	}
+
+	/// Initialize over a copy of `data`, which must be UTF-8
+	pub fn from_bytes(data: &[u8]) -> Result<Self, Error> {
+		let data = std::str::from_utf8(data).map_err(|e| Error::new(ErrorKind::InvalidData, e))?;
+		Ok(Self::from_text(data))
+	}
+
+	/// Initialize over `data`, which must be UTF-8; the buffer is kept, not copied
+	pub fn from_vec(data: Vec<u8>) -> Result<Self, Error> {
+		let data = String::from_utf8(data).map_err(|e| Error::new(ErrorKind::InvalidData, e))?;
+		Ok(Self::from_data(data))
+	}
+
+	/// Initialize over everything `reader` yields, e.g. stdin or a socket
+	pub fn from_reader(mut reader: impl Read) -> Result<Self, Error> {
 		let mut file_data = String::new();
+		reader.read_to_string(&mut file_data)?;
+		Ok(Self::from_data(file_data))
+	}
 
-		let mut file = File::open(filename)?;
-		file.read_to_string(&mut file_data)?;
+	///
+	/// Restrict tokenization to the active `profiles`.
+	/// A `%%profile <name>` tag opens a section that lasts until the next
+	/// `%%profile` tag. Sections whose name is not active are skipped without
+	/// being tokenized; `%%profile all` sections and anything before the first
+	/// profile tag are always kept
+	///
+	pub fn set_profiles(&mut self, profiles: &[&str]) {
+		self.profiles = Some(profiles.iter().map(|p| p.to_string()).collect());
+	}
 
-		let tokens = vec![];
-		let data = vec![];
-		Ok(Self { file_data, tokens, data })
+	/// Tokenize every profile section again
+	pub fn clear_profiles(&mut self) {
+		self.profiles = None;
 	}
 
 	/// Returns total size of tokens
@@ -174,14 +237,80 @@ impl Tokens {
 		&self.tokens
 	}
 
+	/// Data the tokens were produced from; literals index into it
+	pub fn source(&self) -> &str {
+		&self.file_data
+	}
+
+	/// Text of a literal token
+	#[inline]
+	pub fn text(&self, lit: &Lit) -> &str {
+		lit.text(&self.file_data)
+	}
+
+	/// Heap bytes held as (tokens and comment ranges, source text)
+	pub fn heap_bytes(&self) -> (usize, usize) {
+		let errors: usize = self.tokens.iter().map(|t| match t {
+			TokenKind::Err(e) => e.msg.capacity(),
+			_ => 0,
+		}).sum();
+		let tokens = self.tokens.capacity() * size_of::<TokenKind>() + errors
+			+ self.comments.capacity() * size_of::<(u32, u32)>();
+		(tokens, self.file_data.capacity())
+	}
+
+	/// Comment lines, '#' included, in document order
+	pub fn comments(&self) -> impl Iterator<Item = &str> {
+		self.comments.iter().map(|&(start, end)| &self.file_data[start as usize..end as usize])
+	}
+
 	pub fn tokenize(&mut self) -> Result<(), Error>{
-		let len = self.file_data.len();
-		let data = self.file_data.clone();
+		// Taken rather than cloned; restored once tokenizing is done
+		let data = self.take_source();
+		let mut tokens = std::mem::take(&mut self.tokens);
+		let result = self.lex(&data, |token| tokens.push(token));
+		self.restore(data, tokens);
+		result
+	}
+
+	///
+	/// Start over on a copy of `data`, keeping the capacity of the token, comment
+	/// and source buffers. Profiles are kept
+	///
+	pub fn reset(&mut self, data: &str) {
+		self.file_data.clear();
+		self.file_data.push_str(data);
+		self.tokens.clear();
+		self.comments.clear();
+	}
+
+	/// Moves the source text out, e.g. to share it with a tokenizer on another thread
+	pub(crate) fn take_source(&mut self) -> String {
+		std::mem::take(&mut self.file_data)
+	}
+
+	/// Put back the source text and the tokens produced from it
+	pub(crate) fn restore(&mut self, file_data: String, tokens: Vec<TokenKind>) {
+		self.file_data = file_data;
+		self.tokens = tokens;
+	}
+
+	///
+	/// Tokenize `data`, handing each token to `emit` in document order. Blank tokens are
+	/// dropped; comment ranges are recorded on `self`
+	///
+	pub(crate) fn lex(&mut self, data: &str, mut emit: impl FnMut(TokenKind)) -> Result<(), Error> {
+		let _span = crate::span!("tokenize", data.len());
+		let len = data.len();
+		// Literal and comment positions are stored as u32
+		if len > u32::MAX as usize {
+			return Err(Error::new(ErrorKind::InvalidData, "input larger than 4 GiB"))
+		}
 
 		let mut err = false;
 		let mut idx = 0;
-		while idx != len {
-			let cchar = data.chars().nth(idx).unwrap_or('\0');
+		while idx < len {
+			let cchar = str_at(&data, idx);
 			let value = match cchar {
 				//// Colon[':']
 				':' => {
@@ -236,7 +365,7 @@ impl Tokens {
 				//// Dots
 				'.' => {
 					let mut c_idx = idx.clone();
-					while data.chars().nth(c_idx).unwrap() == '.' { c_idx += 1 }
+					while str_at(&data, c_idx) == '.' { c_idx += 1 }
 
 					let count = c_idx - idx;
 					let dot_count = match count {
@@ -257,7 +386,13 @@ impl Tokens {
 					let nchar = str_peek(&data, &idx);
 					let mut token_is: TokenKind = TokenKind::Blank;
 					match nchar {
-						'%' => { idx += 1;  token_is = TokenKind::DbPerc; },
+						'%' => {
+							idx += 1;
+							token_is = match self.skip_profile(&data, idx + 1) {
+								Some(skip_to) => { idx = skip_to; TokenKind::Blank },
+								None => TokenKind::DbPerc,
+							};
+						},
 						'a'..='z' | 'A'..='Z' | '_'   => { token_is = TokenKind::Perc; }
 						// Pointer to a numerical is prohibited
 						' ' | '0'..='9' => {
@@ -271,8 +406,8 @@ impl Tokens {
 				}
 				//// Comment block
 				'#' => {
-					let (skip_to, comment_block) = Self::parse_comment_block(&data, idx.clone());
-					self.data.push(comment_block);
+					let skip_to = Self::parse_comment_block(&data, idx.clone());
+					self.comments.push((idx as u32, skip_to as u32));
 					idx = skip_to;
 					TokenKind::Hash
 				}
@@ -293,46 +428,64 @@ impl Tokens {
 			idx += 1;
 			if value == TokenKind::EOF { break }
 			if err {
-				let err_msg = match value.clone() {
+				let err_msg = match value {
 					TokenKind::Err(e) => e.msg,
 					_ => TokErr::default().msg
 				};
-				eprintln!("{}", err_msg);
-				break
-				// One way to deal with this error is to stack-dump (?)
-				// TODO: Figure out the fastest way to do this ...
+				return Err(Error::new(ErrorKind::InvalidData, err_msg))
 			}
-			self.tokens.push(value);
+			if value != TokenKind::Blank { emit(value); }
 		}
-
-		// Cleanup
-		if !err { self.tokens.retain(|r| *r != TokenKind::Blank); }
 		Ok(())
 	}
 
 	///
-	/// Parse comment block
+	/// If the tag starting at `at` (just past `%%`) opens an inactive profile section,
+	/// returns the index to continue from: the newline before the next `%%profile`
+	/// tag, or the last character of the file
 	///
 	#[inline]
-	fn parse_comment_block(data: &String, mut idx: usize) -> (usize, String) {
-		let c_idx = idx.clone();
-		while data.chars().nth(idx).unwrap() != '\n' { idx += 1; }
-		let skip_by = idx - c_idx;
-		let comment_block: String = data.chars().skip(c_idx).take(skip_by).collect();
-		(idx, comment_block)
+	fn skip_profile(&self, data: &str, at: usize) -> Option<usize> {
+		let profiles = self.profiles.as_ref()?;
+		let mut words = Self::tag_words(data, at);
+		if words.next() != Some("profile") { return None }
+
+		let name = words.next()?;
+		if name == "all" || profiles.iter().any(|p| p == name) { return None }
+
+		let mut search = at;
+		while let Some(pos) = data[search..].find("\n%%") {
+			let nl = search + pos;
+			// Whole word only, so e.g. `%%profiles` does not end the section
+			if Self::tag_words(data, nl + 3).next() == Some("profile") { return Some(nl) }
+			search = nl + 1;
+		}
+		Some(data.len() - 1)
+	}
+
+	/// Words of the tag starting at `at` (just past `%%`), up to the end of its line
+	#[inline]
+	fn tag_words(data: &str, at: usize) -> std::str::SplitWhitespace<'_> {
+		let line_end = data[at..].find('\n').map_or(data.len(), |p| at + p);
+		data[at..line_end].split_whitespace()
+	}
+
+	///
+	/// Parse comment block; returns the index of the newline ending it
+	///
+	#[inline]
+	fn parse_comment_block(data: &str, idx: usize) -> usize {
+		data[idx..].find('\n').map_or(data.len(), |p| idx + p)
 	}
 
 	///
 	/// Create 'fancy' error block
 	///
 	#[inline]
-	fn generate_err_block(data: &String, idx: &usize, msg: &str) -> String {
+	fn generate_err_block(data: &str, idx: &usize, msg: &str) -> String {
 		let c_idx = idx.clone();
-		let mut w_idx = idx.clone();
-		while data.chars().nth(w_idx).unwrap() != '\n' {
-			w_idx += 1;
-		}
-		let mut error: String = data.chars().skip(*idx).take(w_idx - c_idx).collect();
+		let w_idx = data[c_idx..].find('\n').map_or(data.len(), |p| c_idx + p);
+		let mut error = data[c_idx..w_idx].to_string();
 		error.push_str("\n^~~~");
 		error.push_str(msg);
 		error
@@ -343,16 +496,16 @@ impl Tokens {
 	/// TODO: Return error on failure
 	///
 	#[inline]
-	fn process_alpha_numeric_misc(data: &String, idx: &usize) -> (TokenKind, usize) {
+	fn process_alpha_numeric_misc(data: &str, idx: &usize) -> (TokenKind, usize) {
 		let mut c_idx = idx.clone();
-		let mut token = TokenKind::EOF;
 
 		let failure = false;
-		let mut value: String = String::new();
+		let start = *idx;
+		let mut value_len = 0;
 		let err: TokErr = TokErr { msg: "".to_string() };
 
 		loop {
-			let c_value = data.chars().nth(c_idx).unwrap();
+			let c_value = str_at(data, c_idx);
 			// TODO: Logic fix
 			// Current logic increments the index counter raising issues in the program.
 			// If it encounters these characters then it tries to decrement the counter by one
@@ -364,23 +517,21 @@ impl Tokens {
 
 			if is_valid {
 				c_idx += 1;
-				value.push(c_value);
+				value_len += 1;
 			} else { break; }
 		}
 
 		// Return early
 		if failure { return (TokenKind::Err(err), c_idx) }
-		if value.is_empty() { return (TokenKind::Blank, c_idx) }
+		if value_len == 0 { return (TokenKind::Blank, c_idx) }
 
-		if value.chars().all(char::is_alphanumeric) || !value.is_empty() {
-			// Integer Check
-			let lit_check = match value.parse::<i64>() {
-				Ok(_) => LitKind::Float,
-				Err(_) => LitKind::String
-			};
-			let lit_kind = Lit::new(lit_check, value);
-			token = TokenKind::Literal(lit_kind);
-		}
+		// Integer Check
+		let lit_check = match data[start..start + value_len].parse::<i64>() {
+			Ok(_) => LitKind::Int,
+			Err(_) => LitKind::String
+		};
+		let lit_kind = Lit::new(lit_check, start as u32, value_len as u32);
+		let token = TokenKind::Literal(lit_kind);
 		(token, c_idx)
 	}
 
@@ -388,7 +539,7 @@ impl Tokens {
 	/// n block characters include @, &, and $
 	///
 	#[inline]
-	fn process_n_block_chars(data: &String, idx: &usize, r_type: TokenKind) -> (TokenKind, usize) {
+	fn process_n_block_chars(data: &str, idx: &usize, r_type: TokenKind) -> (TokenKind, usize) {
 		let w_idx = idx.clone();
 		let nchar = str_peek(&data, &w_idx);
 
@@ -1,5 +1,5 @@
 /// Types: Type of value
-#[derive(Debug)]
+#[derive(Debug, PartialEq, Clone, Copy)]
 pub enum Types {
 	I8,
 	I16,
@@ -24,7 +24,7 @@ pub enum Types {
 ///  * Ref: Reference (String): Stores container id
 ///  * Value
 ///
-#[derive(Debug)]
+#[derive(Debug, PartialEq, Clone, Copy)]
 pub enum ValType {
 	Ptr,
 	Ref,
@@ -0,0 +1,160 @@
+//! Tracing spans, exported as Chrome trace-event JSON (chrome://tracing, Perfetto).
+//! Built only with `--features trace`; otherwise the `span!` macros expand to nothing
+//! and their arguments are never evaluated.
+//!
+//! ```ignore
+//! let _span = span!("resolve");
+//! let _span = span!("container", &name);
+//! ```
+//! Spans close when their guard drops. Events are buffered per thread and handed
+//! to the collector when the thread's outermost span closes, so work finished on
+//! any thread is visible to `write_chrome`/`save`.
+
+#[cfg(feature = "trace")]
+pub use enabled::*;
+
+#[cfg(feature = "trace")]
+#[macro_export]
+macro_rules! span {
+	($name:expr) => { $crate::trace::Span::new($name, String::new()) };
+	($name:expr, $detail:expr) => { $crate::trace::Span::new($name, ($detail).to_string()) };
+}
+
+#[cfg(not(feature = "trace"))]
+#[macro_export]
+macro_rules! span {
+	($($args:tt)*) => { () };
+}
+
+/// True when spans are being recorded
+pub const ENABLED: bool = cfg!(feature = "trace");
+
+#[cfg(feature = "trace")]
+mod enabled {
+	use std::cell::RefCell;
+	use std::fs::File;
+	use std::io::{BufWriter, Error, Write};
+	use std::path::Path;
+	use std::sync::atomic::{AtomicU32, Ordering};
+	use std::sync::{Mutex, OnceLock};
+	use std::time::Instant;
+
+	struct Event {
+		name: &'static str,
+		detail: String,
+		tid: u32,
+		/// Microseconds since the first span of the process
+		start: f64,
+		dur: f64,
+	}
+
+	struct Buffer {
+		tid: u32,
+		/// Open spans on this thread
+		depth: u32,
+		events: Vec<Event>,
+	}
+
+	impl Drop for Buffer {
+		fn drop(&mut self) { flush(&mut self.events); }
+	}
+
+	fn epoch() -> Instant {
+		static EPOCH: OnceLock<Instant> = OnceLock::new();
+		*EPOCH.get_or_init(Instant::now)
+	}
+
+	fn collected() -> &'static Mutex<Vec<Event>> {
+		static EVENTS: OnceLock<Mutex<Vec<Event>>> = OnceLock::new();
+		EVENTS.get_or_init(|| Mutex::new(vec![]))
+	}
+
+	fn flush(events: &mut Vec<Event>) {
+		if events.is_empty() { return }
+		collected().lock().unwrap().append(events);
+	}
+
+	thread_local! {
+		static BUFFER: RefCell<Buffer> = RefCell::new(Buffer {
+			tid: {
+				static NEXT_TID: AtomicU32 = AtomicU32::new(1);
+				NEXT_TID.fetch_add(1, Ordering::Relaxed)
+			},
+			depth: 0,
+			events: vec![],
+		});
+	}
+
+	/// Open span; records a complete ("X") event when dropped
+	pub struct Span {
+		name: &'static str,
+		detail: String,
+		start: Instant,
+	}
+
+	impl Span {
+		#[inline]
+		pub fn new(name: &'static str, detail: String) -> Self {
+			epoch();
+			let _ = BUFFER.try_with(|buffer| buffer.borrow_mut().depth += 1);
+			Self { name, detail, start: Instant::now() }
+		}
+	}
+
+	impl Drop for Span {
+		fn drop(&mut self) {
+			let start = self.start.duration_since(epoch()).as_secs_f64() * 1e6;
+			let dur = self.start.elapsed().as_secs_f64() * 1e6;
+			let (name, detail) = (self.name, std::mem::take(&mut self.detail));
+			// Spans dropped during thread teardown have no buffer left to record into
+			let _ = BUFFER.try_with(|buffer| {
+				let mut buffer = buffer.borrow_mut();
+				let tid = buffer.tid;
+				buffer.events.push(Event { name, detail, tid, start, dur });
+				buffer.depth -= 1;
+				if buffer.depth == 0 { flush(&mut buffer.events); }
+			});
+		}
+	}
+
+	///
+	/// Write every closed span as Chrome trace-event JSON.
+	/// Spans nested in a span that is still open are not included yet
+	///
+	pub fn write_chrome(out: &mut impl Write) -> Result<(), Error> {
+		let events = collected().lock().unwrap();
+
+		out.write_all(b"{\"traceEvents\":[\n")?;
+		for (e_idx, event) in events.iter().enumerate() {
+			if e_idx > 0 { out.write_all(b",\n")?; }
+			write!(out, "{{\"name\":\"{}\",\"cat\":\"vtc\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3},\"dur\":{:.3}",
+				event.name, event.tid, event.start, event.dur)?;
+			if !event.detail.is_empty() {
+				out.write_all(b",\"args\":{\"detail\":\"")?;
+				write_escaped(out, &event.detail)?;
+				out.write_all(b"\"}")?;
+			}
+			out.write_all(b"}")?;
+		}
+		out.write_all(b"\n]}\n")
+	}
+
+	/// Write the trace to `path`
+	pub fn save(path: &Path) -> Result<(), Error> {
+		let mut out = BufWriter::new(File::create(path)?);
+		write_chrome(&mut out)?;
+		out.flush()
+	}
+
+	fn write_escaped(out: &mut impl Write, value: &str) -> Result<(), Error> {
+		for c in value.chars() {
+			match c {
+				'"' => out.write_all(b"\\\"")?,
+				'\\' => out.write_all(b"\\\\")?,
+				c if (c as u32) < 0x20 => write!(out, "\\u{:04x}", c as u32)?,
+				c => write!(out, "{}", c)?,
+			}
+		}
+		Ok(())
+	}
+}
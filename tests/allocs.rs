@@ -0,0 +1,136 @@
+//!
+//! Allocation budgets, checked with a counting global allocator against
+//! config/examples and a generated corpus. Fails when a phase allocates beyond
+//! its budget:
+//! * lex: nothing per token; only the token and comment vectors grow
+//! * parse: bounded per container, variable and value; nothing per punctuation token
+//! * resolve: nothing per container or reference; only a scratch buffer grows
+//! * reuse: re-parsing and resolving on a warm parser (`RParser::parse_into`) allocates
+//!   only the parsed tags, values and error message; no buffer grows
+//!
+
+use std::fs;
+use std::hint::black_box;
+use std::path::{Path, PathBuf};
+use vtc::alloc::{self, CountingAlloc};
+use vtc::corpus;
+use vtc::serializer::parser::{RParser, VarType};
+use vtc::serializer::token::Tokens;
+
+#[global_allocator]
+static ALLOC: CountingAlloc = CountingAlloc;
+
+const PER_CONTAINER: usize = 3;
+const PER_VAR: usize = 3;
+const PER_VALUE: usize = 3;
+const PER_TAG: usize = 2;
+/// Formatting a syntax error message
+const ERROR: usize = 8;
+const FIXED: usize = 64;
+
+/// Allocations made by `f`
+fn allocs<T>(f: impl FnOnce() -> T) -> (T, usize) {
+	let before = alloc::snapshot();
+	let value = f();
+	(value, alloc::snapshot().since(&before).allocs)
+}
+
+/// Amortized vector growth: one allocation per doubling
+fn growth(len: usize) -> usize {
+	(usize::BITS - len.leading_zeros()) as usize
+}
+
+struct Row {
+	name: String,
+	tokens: usize,
+	tags: usize,
+	errors: usize,
+	containers: usize,
+	vars: usize,
+	values: usize,
+	lex: usize,
+	parse: usize,
+	resolve: usize,
+	reuse: usize,
+}
+
+impl Row {
+	fn lex_budget(&self) -> usize { FIXED + 2 * growth(self.tokens) }
+	fn parse_budget(&self) -> usize { FIXED + PER_CONTAINER * self.containers + PER_VAR * self.vars + PER_VALUE * self.values }
+	fn resolve_budget(&self) -> usize { FIXED }
+	fn reuse_budget(&self) -> usize {
+		PER_TAG * self.tags + ERROR * self.errors + PER_CONTAINER * self.containers + PER_VAR * self.vars + PER_VALUE * self.values
+	}
+}
+
+fn measure(name: String, path: &Path) -> Row {
+	let mut tokens = Tokens::new(path.to_str().unwrap()).unwrap();
+	let (_, lex) = allocs(|| tokens.tokenize().unwrap());
+	let token_count = tokens.len();
+
+	let mut parser = RParser::new(tokens);
+	let (_, parse) = allocs(|| parser.generate_ast());
+	let (_, resolve) = allocs(|| black_box(parser.resolve()));
+
+	let vars: usize = parser.containers().iter().map(|c| c.values.len()).sum();
+	let values: usize = parser.containers().iter().flat_map(|c| &c.values).map(|(_, v)| match v {
+		VarType::List(values) => values.len(),
+		VarType::EmptyList(_) => 0,
+	}).sum();
+	let data = fs::read_to_string(path).unwrap();
+	let (_, reuse) = allocs(|| {
+		parser.parse_into(&data).unwrap();
+		black_box(parser.resolve())
+	});
+	Row {
+		name, tokens: token_count, tags: parser.tags().len(), errors: parser.error().map_or(0, |_| 1),
+		containers: parser.containers().len(), vars, values, lex, parse, resolve, reuse,
+	}
+}
+
+fn examples(dir: &Path, out: &mut Vec<PathBuf>) {
+	let mut entries: Vec<PathBuf> = fs::read_dir(dir).unwrap().filter_map(|e| e.ok().map(|e| e.path())).collect();
+	entries.sort();
+	for path in entries {
+		if path.is_dir() { examples(&path, out); }
+		else if path.extension().map_or(false, |e| e == "vtc") { out.push(path); }
+	}
+}
+
+///
+/// One test: the counters are process-wide, so phases of concurrently running
+/// tests would be counted against each other. Tracing allocates per span, so the
+/// budgets only hold without it
+///
+#[test]
+#[cfg_attr(feature = "trace", ignore)]
+fn allocations_within_budget() {
+	alloc::enable_counting();
+	let root = Path::new(env!("CARGO_MANIFEST_DIR"));
+	let mut paths = vec![];
+	examples(&root.join("config/examples"), &mut paths);
+
+	let mut rows: Vec<Row> = paths.iter()
+		.map(|p| measure(p.strip_prefix(root).unwrap_or(p).display().to_string(), p))
+		.collect();
+
+	let generated = std::env::temp_dir().join(format!("vtc-allocs-{}.vtc", std::process::id()));
+	fs::write(&generated, corpus::generate(256 << 10, 1)).unwrap();
+	rows.push(measure("generated 256K".to_string(), &generated));
+	fs::remove_file(&generated).ok();
+
+	let mut over_budget = vec![];
+	println!("{:<44} {:>8} {:>14} {:>14} {:>14} {:>14}", "file", "tokens", "lex/budget", "parse/budget", "resolve/budget", "reuse/budget");
+	for row in &rows {
+		let over = row.lex > row.lex_budget() || row.parse > row.parse_budget() || row.resolve > row.resolve_budget()
+			|| row.reuse > row.reuse_budget();
+		if over { over_budget.push(row.name.as_str()); }
+		println!("{:<44} {:>8} {:>14} {:>14} {:>14} {:>14}{}", row.name, row.tokens,
+			format!("{}/{}", row.lex, row.lex_budget()),
+			format!("{}/{}", row.parse, row.parse_budget()),
+			format!("{}/{}", row.resolve, row.resolve_budget()),
+			format!("{}/{}", row.reuse, row.reuse_budget()),
+			if over { "  OVER BUDGET" } else { "" });
+	}
+	assert!(over_budget.is_empty(), "over budget: {}", over_budget.join(", "));
+}
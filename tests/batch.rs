@@ -0,0 +1,41 @@
+mod common;
+
+use std::fs;
+use std::path::PathBuf;
+use vtc::batch;
+
+/// Fresh directory with an empty `sub` directory
+fn scratch_dir(name: &str) -> PathBuf {
+	let dir = common::scratch_dir(&format!("batch-{}", name));
+	fs::create_dir_all(dir.join("sub")).unwrap();
+	dir
+}
+
+#[test]
+fn checks_in_input_order() {
+	let dir = scratch_dir("order");
+	fs::write(dir.join("a.vtc"), "@a:\n\t$x := [1]\n\t$y := [&b.z]\n").unwrap();
+	fs::write(dir.join("sub/b.vtc"), "@b:\n\t$z := [2]\n:= [3]\n").unwrap();
+	fs::write(dir.join("sub/notes.txt"), "not a document").unwrap();
+
+	let paths = batch::expand(&[dir.to_str().unwrap().to_string()]).unwrap();
+	assert_eq!(paths, vec![dir.join("a.vtc"), dir.join("sub/b.vtc")]);
+	let results = batch::check_all(&paths, &[], 2);
+	assert_eq!(results.iter().map(|r| &r.path).collect::<Vec<_>>(), paths.iter().collect::<Vec<_>>());
+	assert_eq!((results[0].error.is_none(), results[0].unresolved), (true, 1));
+	assert!(results[1].error.is_some());
+
+	assert!(batch::expand(&[dir.join("sub/*.none").to_str().unwrap().to_string()]).is_err());
+}
+
+#[test]
+#[cfg(unix)]
+fn symlinked_directories_are_not_followed() {
+	let dir = scratch_dir("links");
+	fs::write(dir.join("a.vtc"), "@a:\n\t$x := [1]\n").unwrap();
+	std::os::unix::fs::symlink(&dir, dir.join("sub/loop")).unwrap();
+	std::os::unix::fs::symlink(dir.join("a.vtc"), dir.join("sub/link.vtc")).unwrap();
+
+	let paths = batch::expand(&[dir.to_str().unwrap().to_string()]).unwrap();
+	assert_eq!(paths, vec![dir.join("a.vtc"), dir.join("sub/link.vtc")]);
+}
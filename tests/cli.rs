@@ -0,0 +1,58 @@
+mod common;
+
+use std::env;
+use std::path::PathBuf;
+use std::process::{Command, Output};
+use common::{scratch_dir, write, BROKEN};
+
+const DOC: &str = "@a:\n\t$x := [1, 2]\n\t$y := [&a.x]\n";
+
+/// Write `data` to `name` in a fresh directory for the test `test`
+fn scratch(test: &str, name: &str, data: &str) -> PathBuf {
+	write(&scratch_dir(&format!("cli-{}", test)), name, data)
+}
+
+fn vtc(args: &[&str]) -> Output {
+	Command::new(env!("CARGO_BIN_EXE_vtc")).args(args).output().unwrap()
+}
+
+fn status(args: &[&str]) -> i32 {
+	vtc(args).status.code().unwrap()
+}
+
+#[test]
+fn single_file() {
+	let doc = scratch("single", "doc.vtc", DOC);
+	let doc = doc.to_str().unwrap();
+	assert_eq!(status(&["-f", doc]), 0);
+	assert_eq!(status(&["-f", doc, "--overlap"]), 0);
+	assert_eq!(status(&["-f", doc, "--stats"]), 0);
+
+	let broken = scratch("single-broken", "broken.vtc", BROKEN);
+	let output = vtc(&["-f", broken.to_str().unwrap()]);
+	assert_eq!(output.status.code(), Some(1));
+	assert!(String::from_utf8_lossy(&output.stderr).contains("broken.vtc"));
+}
+
+#[test]
+fn overlap_conflicts_are_usage_errors() {
+	let doc = scratch("overlap", "overlap.vtc", DOC);
+	let doc = doc.to_str().unwrap();
+	assert_eq!(status(&["-f", doc, "--overlap", "--stats"]), 2);
+	assert_eq!(status(&["-f", doc, "--overlap", "--explain", "3"]), 2);
+	assert_eq!(status(&["-f", doc, "--overlap", "--cache-dir", env::temp_dir().to_str().unwrap()]), 2);
+}
+
+#[test]
+fn no_inputs_is_a_usage_error() {
+	assert_eq!(status(&[]), 2);
+}
+
+#[test]
+#[cfg(feature = "trace")]
+fn trace_is_saved_on_failure() {
+	let broken = scratch("trace", "traced.vtc", BROKEN);
+	let trace = broken.with_extension("json");
+	assert_eq!(status(&["-f", broken.to_str().unwrap(), "--trace", trace.to_str().unwrap()]), 1);
+	assert!(std::fs::read_to_string(&trace).unwrap().starts_with("{\"traceEvents\""));
+}
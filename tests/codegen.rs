@@ -0,0 +1,31 @@
+mod common;
+
+use common::resolved;
+use vtc::codegen::rust::{self, StaticContainer, StaticDoc, StaticList, StaticVar};
+use vtc::key;
+use vtc::serializer::access::{hash_path, Key};
+
+/// Two paths forced onto one hash, as a real collision would be
+static COLLIDING: StaticDoc = StaticDoc {
+	containers: &[StaticContainer { name: "a", vars: &[
+		StaticVar { name: "x", list: StaticList::Int(&[1]) },
+		StaticVar { name: "y", list: StaticList::Int(&[2]) },
+	] }],
+	keys: &[(7, "a.x", 0, 0), (7, "a.y", 0, 1)],
+};
+
+#[test]
+fn static_lookup_compares_paths() {
+	assert_eq!(COLLIDING.ints(Key { hash: 7, path: "a.x" }), Some(&[1][..]));
+	assert_eq!(COLLIDING.ints(Key { hash: 7, path: "a.y" }), Some(&[2][..]));
+	assert_eq!(COLLIDING.ints(Key { hash: 7, path: "a.z" }), None);
+	assert_eq!(COLLIDING.ints(key!("a.x")), None);
+}
+
+#[test]
+fn generated_keys_keep_the_latest_definition() {
+	let source = rust::generate(&resolved("@a:\n\t$x := [1]\n\t$x := [2]\n\t$y := [3]\n"), "DOC");
+	assert!(source.contains(&format!("({:#x}, \"a.x\", 0, 1)", hash_path("a.x"))));
+	assert!(!source.contains(&format!("({:#x}, \"a.x\", 0, 0)", hash_path("a.x"))));
+	assert!(source.contains(&format!("({:#x}, \"a.y\", 0, 2)", hash_path("a.y"))));
+}
@@ -0,0 +1,61 @@
+//! Helpers shared by the integration tests. Each test binary uses only some of them
+#![allow(dead_code)]
+
+use std::env;
+use std::fs;
+use std::path::{Path, PathBuf};
+use vtc::serializer::parser::RParser;
+use vtc::serializer::token::Tokens;
+
+/// Lexes cleanly, but text outside a container is a syntax error
+pub const BROKEN: &str = "@a:\n\t$x := [1]\n:= [2]\n";
+
+/// Tokenize and parse `data` with `profiles` active, asserting it has no syntax error
+pub fn parse_with(data: &str, profiles: &[&str]) -> RParser {
+	let mut tokens = Tokens::from_text(data);
+	if !profiles.is_empty() { tokens.set_profiles(profiles); }
+	tokens.tokenize().unwrap();
+	let mut parser = RParser::new(tokens);
+	parser.generate_ast();
+	assert_eq!(parser.error(), None);
+	parser
+}
+
+/// As `parse_with`, with no profiles
+pub fn parse(data: &str) -> RParser {
+	parse_with(data, &[])
+}
+
+/// As `parse`, then resolved
+pub fn resolved(data: &str) -> RParser {
+	let mut parser = parse(data);
+	parser.resolve();
+	parser
+}
+
+/// Debug form of every tag and container, and the error if any, for comparing documents
+pub fn dump(parser: &RParser) -> Vec<String> {
+	let tags = parser.tags().iter().map(|t| format!("{:?}", t));
+	let containers = parser.containers().iter().map(|c| format!("{} {:?}", c.c_name, c.values));
+	tags.chain(containers).chain(parser.error().map(str::to_string)).collect()
+}
+
+///
+/// Empty directory `vtc-<name>-<pid>` under the system temp directory. Anything left
+/// from an earlier run is removed first, so stale files cannot hide failures.
+/// `name` must be unique per test, since tests run concurrently
+///
+pub fn scratch_dir(name: &str) -> PathBuf {
+	let dir = env::temp_dir().join(format!("vtc-{}-{}", name, std::process::id()));
+	let _ = fs::remove_dir_all(&dir);
+	fs::create_dir_all(&dir).unwrap();
+	fs::canonicalize(dir).unwrap()
+}
+
+/// Write `data` to `dir`/`name`, creating parent directories
+pub fn write(dir: &Path, name: &str, data: &str) -> PathBuf {
+	let path = dir.join(name);
+	fs::create_dir_all(path.parent().unwrap()).unwrap();
+	fs::write(&path, data).unwrap();
+	path
+}
@@ -0,0 +1,127 @@
+mod common;
+
+use std::fs;
+use std::path::Path;
+use std::thread;
+use common::{dump, resolved as parse, scratch_dir};
+use vtc::serializer::compiled::{self, DiskCache, SourceId};
+
+const DOC: &str = "\
+%%tag value
+@a:
+\t$ints := [1, 2, 3]
+\t$mixed := [s1, 2.5, &a.ints->(0..1)]
+\t$none := []
+@b:
+\t$ptr := [ %a->(1..2) ]
+\t$whole := [&a]
+";
+
+/// Files in `dir` with extension `ext`
+fn count(dir: &Path, ext: &str) -> usize {
+	fs::read_dir(dir).unwrap().filter(|e| e.as_ref().unwrap().path().extension().map_or(false, |x| x == ext)).count()
+}
+
+fn entries(dir: &Path) -> usize {
+	count(dir, "vtcc")
+}
+
+#[test]
+fn round_trip() {
+	let parser = parse(DOC);
+	let source = SourceId::of(DOC.as_bytes());
+	let encoded = compiled::encode(&parser, source, &["dev"]);
+	let decoded = compiled::decode(&encoded, source, &["dev"]).unwrap();
+	assert_eq!(dump(&decoded), dump(&parser));
+	assert_eq!(decoded.get_list::<i64>(vtc::key!("a.ints")), Some(vec![1, 2, 3]));
+
+	// Another source or profile set, truncated data
+	assert!(compiled::decode(&encoded, SourceId::of(b"@a:\n"), &["dev"]).is_err());
+	assert!(compiled::decode(&encoded, source, &[]).is_err());
+	assert!(compiled::decode(&encoded, source, &["prod"]).is_err());
+	assert!(compiled::decode(&encoded[..encoded.len() - 1], source, &["dev"]).is_err());
+}
+
+#[test]
+fn matching_hash_alone_is_not_a_hit() {
+	let source = SourceId::of(DOC.as_bytes());
+	let encoded = compiled::encode(&parse(DOC), source, &[]);
+	assert!(compiled::decode(&encoded, SourceId { len: source.len + 1, ..source }, &[]).is_err());
+	assert!(compiled::decode(&encoded, SourceId { check: !source.check, ..source }, &[]).is_err());
+	assert_ne!(SourceId::of(b"ab").check, SourceId::of(b"ba").check);
+}
+
+#[test]
+fn disk_cache_hit_matches_parse() {
+	let dir = scratch_dir("compiled-hit");
+	let cache = DiskCache::new(&dir).unwrap();
+	let parsed = cache.load_bytes(DOC.as_bytes().to_vec(), &[]).unwrap();
+	assert_eq!(entries(&dir), 1);
+	let cached = cache.load_bytes(DOC.as_bytes().to_vec(), &[]).unwrap();
+	assert_eq!(dump(&cached), dump(&parsed));
+	assert_eq!(dump(&cached), dump(&parse(DOC)));
+}
+
+#[test]
+fn syntax_errors_are_not_cached() {
+	let dir = scratch_dir("compiled-error");
+	let cache = DiskCache::new(&dir).unwrap();
+	assert!(cache.load_bytes(common::BROKEN.as_bytes().to_vec(), &[]).is_err());
+	assert_eq!(entries(&dir), 0);
+}
+
+#[test]
+fn profile_sets_do_not_collide() {
+	let data = "%%profile prod\n@a:\n\t$x := [1]\n%%profile all\n@b:\n\t$y := [2]\n";
+	let dir = scratch_dir("compiled-profiles");
+	let cache = DiskCache::new(&dir).unwrap();
+	let profiles = |names: &[&str]| names.iter().map(|n| n.to_string()).collect::<Vec<_>>();
+
+	let prod = cache.load_bytes(data.as_bytes().to_vec(), &profiles(&["prod"])).unwrap();
+	assert!(prod.container("a").is_some());
+	let split = cache.load_bytes(data.as_bytes().to_vec(), &profiles(&["pr", "od"])).unwrap();
+	assert!(split.container("a").is_none());
+	assert_eq!(entries(&dir), 2);
+
+	// Order and repeats do not matter
+	cache.load_bytes(data.as_bytes().to_vec(), &profiles(&["od", "pr", "od"])).unwrap();
+	assert_eq!(entries(&dir), 2);
+}
+
+#[test]
+fn corrupt_counts_fail_cleanly() {
+	// An empty document ends with its tag and container counts
+	let encoded = compiled::encode(&parse(""), SourceId::default(), &[]);
+	let counts = encoded.len() - 8;
+	for at in [counts, counts + 4] {
+		let mut corrupt = encoded.clone();
+		corrupt[at..at + 4].copy_from_slice(&u32::MAX.to_le_bytes());
+		assert!(compiled::decode(&corrupt, SourceId::default(), &[]).is_err());
+	}
+}
+
+#[test]
+fn failed_writes_still_return_the_parse() {
+	let dir = scratch_dir("compiled-unwritable");
+	let cache = DiskCache::new(&dir).unwrap();
+	fs::remove_dir(&dir).unwrap();
+	let parsed = cache.load_bytes(DOC.as_bytes().to_vec(), &[]).unwrap();
+	assert_eq!(dump(&parsed), dump(&parse(DOC)));
+	assert!(!dir.exists());
+}
+
+#[test]
+fn concurrent_stores_do_not_collide() {
+	let dir = scratch_dir("compiled-concurrent");
+	let cache = DiskCache::new(&dir).unwrap();
+	thread::scope(|scope| {
+		for _ in 0..8 {
+			scope.spawn(|| for _ in 0..16 {
+				let parsed = cache.load_bytes(DOC.as_bytes().to_vec(), &[]).unwrap();
+				assert_eq!(dump(&parsed), dump(&parse(DOC)));
+			});
+		}
+	});
+	assert_eq!(entries(&dir), 1);
+	assert_eq!(count(&dir, "tmp"), 0);
+}
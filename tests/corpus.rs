@@ -0,0 +1,65 @@
+mod common;
+
+use vtc::corpus::{self, Shape};
+use vtc::serializer::parser::{RParser, VarType};
+use vtc::serializer::types::ValType;
+
+/// Parse and resolve `data`, asserting every reference and pointer resolves
+fn check(data: &str) -> RParser {
+	let parser = common::resolved(data);
+	for container in parser.containers() {
+		for (name, value) in &container.values {
+			if let VarType::List(values) = value {
+				for value in values.iter().filter(|v| v.store_type != ValType::Value) {
+					assert!(value.resolved.is_some(), "{}.{} = {} is unresolved", container.c_name, name, value.value);
+				}
+			}
+		}
+	}
+	parser
+}
+
+#[test]
+fn shapes_generate_valid_documents() {
+	let shapes = [
+		Shape::default(),
+		Shape { refs: 0.9, chain_depth: 3, range: 2, ..Shape::default() },
+		Shape { vars: 1, chain_depth: 4, refs: 1.0, ..Shape::default() },
+	];
+	for shape in shapes {
+		for seed in 1..4 { check(&shape.generate(seed)); }
+	}
+}
+
+#[test]
+fn empty_lists_and_containers() {
+	let parser = check(&Shape { list_len: 0, refs: 1.0, containers: 4, ..Shape::default() }.generate(1));
+	assert!(parser.containers().iter().flat_map(|c| &c.values).all(|(_, v)| match v {
+		VarType::EmptyList(_) => true,
+		VarType::List(values) => values.iter().all(|v| v.store_type == ValType::Ptr),
+	}));
+
+	let parser = check(&Shape { vars: 0, refs: 1.0, containers: 4, ..Shape::default() }.generate(1));
+	assert_eq!(parser.containers().len(), 4);
+	assert!(parser.containers().iter().all(|c| c.values.is_empty()));
+}
+
+#[test]
+fn sized_documents() {
+	let data = corpus::generate(64 << 10, 1);
+	assert!(data.len() > 32 << 10 && data.len() < 128 << 10);
+	check(&data);
+	assert_eq!(corpus::generate(4096, 9), corpus::generate(4096, 9));
+}
+
+#[test]
+fn parse_size() {
+	assert_eq!(corpus::parse_size("512"), Some(512));
+	assert_eq!(corpus::parse_size(" 64k "), Some(64 << 10));
+	assert_eq!(corpus::parse_size("3M"), Some(3 << 20));
+	assert_eq!(corpus::parse_size("1G"), Some(1 << 30));
+	assert_eq!(corpus::parse_size(""), None);
+	assert_eq!(corpus::parse_size("M"), None);
+	assert_eq!(corpus::parse_size("12x"), None);
+	assert_eq!(corpus::parse_size(&format!("{}G", usize::MAX)), None);
+}
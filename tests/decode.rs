@@ -0,0 +1,99 @@
+mod common;
+
+use common::parse;
+use vtc::serializer::parser::VarType;
+use vtc::vtc_struct;
+
+const DOC: &str = "\
+@server:
+\t$port := [8080]
+\t$ratio := [0.5]
+\t$name := [\"edge\"]
+\t$hosts := [\"a\", \"b\"]
+\t$weights := [1, 2, 3]
+\t$none := []
+";
+
+vtc_struct! {
+	#[derive(Debug, PartialEq)]
+	struct Server<'a> {
+		port: u16,
+		ratio: f64,
+		name: &'a str,
+		hosts: Vec<String>,
+		weights: Vec<i64>,
+		none: Vec<i64>,
+		timeout: Option<u32>,
+		ports: Option<Vec<u16>>,
+	}
+}
+
+vtc_struct! {
+	struct Owned {
+		name: String,
+	}
+}
+
+vtc_struct! {
+	struct Required {
+		timeout: u32,
+	}
+}
+
+vtc_struct! {
+	struct Mismatched {
+		name: i64,
+	}
+}
+
+vtc_struct! {
+	struct MixedList {
+		hosts: Vec<i64>,
+	}
+}
+
+#[test]
+fn decodes_scalars_lists_and_options() {
+	let parser = parse(DOC);
+	let server: Server = parser.decode("server").unwrap();
+	assert_eq!(server, Server {
+		port: 8080,
+		ratio: 0.5,
+		name: "edge",
+		hosts: vec!["a".to_string(), "b".to_string()],
+		weights: vec![1, 2, 3],
+		none: vec![],
+		timeout: None,
+		ports: None,
+	});
+}
+
+#[test]
+fn str_fields_borrow_from_the_document() {
+	let parser = parse(DOC);
+	let server: Server = parser.decode("server").unwrap();
+	let stored = match parser.lookup_path("server.name") {
+		Some(VarType::List(values)) => values[0].value.as_str(),
+		_ => unreachable!(),
+	};
+	assert_eq!(server.name.as_ptr(), stored.as_ptr());
+	let owned: Owned = parser.decode("server").unwrap();
+	assert_eq!(owned.name, "edge");
+}
+
+#[test]
+fn missing_variable_is_an_error() {
+	let parser = parse(DOC);
+	let err = parser.decode::<Required>("server").err().unwrap();
+	assert_eq!(err.msg, "server.timeout: missing");
+	assert_eq!(parser.decode::<Owned>("client").err().unwrap().msg, "client: no such container");
+}
+
+#[test]
+fn type_mismatch_is_an_error() {
+	let parser = parse(DOC);
+	let err = parser.decode::<Mismatched>("server").err().unwrap();
+	assert!(err.msg.starts_with("server.name: cannot decode as i64"), "{}", err.msg);
+	let err = parser.decode::<MixedList>("server").err().unwrap();
+	assert!(err.msg.starts_with("server.hosts: cannot decode"), "{}", err.msg);
+}
@@ -0,0 +1,23 @@
+mod common;
+
+use common::{scratch_dir, write, BROKEN};
+use vtc::codegen;
+use vtc::serializer::parser::RParser;
+use vtc::serializer::token::Tokens;
+
+#[test]
+fn broken_is_a_syntax_error() {
+	let mut tokens = Tokens::from_text(BROKEN);
+	tokens.tokenize().unwrap();
+	let mut parser = RParser::new(tokens);
+	parser.generate_ast();
+	assert!(parser.error().is_some());
+}
+
+#[test]
+fn embed_rejects_syntax_errors() {
+	let input = write(&scratch_dir("errors-embed"), "embed.vtc", BROKEN);
+	let output = input.with_extension("rs");
+	assert!(codegen::rust::embed(input.to_str().unwrap(), output.to_str().unwrap(), "DOC").is_err());
+	assert!(!output.exists());
+}
@@ -0,0 +1,96 @@
+use std::ffi::CString;
+use std::os::raw::c_char;
+use std::{ptr, slice, str};
+use vtc::ffi::*;
+
+const DOC: &str = "@a:\n\t$ints := [1, 2]\n\t$ref := [&a.ints]\n\t$none := []\n\t$slice := [&a.ints->(0..1), &a.ints->1]\n";
+
+unsafe fn text<'a>(s: &vtc_str) -> &'a str {
+	str::from_utf8(slice::from_raw_parts(s.ptr as *const u8, s.len)).unwrap()
+}
+
+unsafe fn load(data: &str) -> *mut vtc_doc {
+	vtc_load(data.as_ptr() as *const c_char, data.len())
+}
+
+unsafe fn query(doc: *const vtc_doc, path: &str) -> Result<vtc_list, i32> {
+	let mut list = vtc_list { items: ptr::null(), len: 0 };
+	match vtc_query(doc, path.as_ptr() as *const c_char, path.len(), &mut list) {
+		VTC_OK => Ok(list),
+		code => Err(code),
+	}
+}
+
+unsafe fn last_error<'a>() -> Option<&'a str> {
+	let mut out = vtc_str { ptr: ptr::null(), len: 0 };
+	match vtc_last_error(&mut out) {
+		VTC_OK => Some(text(&out)),
+		_ => None,
+	}
+}
+
+#[test]
+fn load_and_query() {
+	unsafe {
+		let doc = load(DOC);
+		assert!(!doc.is_null());
+		assert_eq!(last_error(), None);
+		assert_eq!(vtc_container_count(doc), 1);
+
+		let ints = query(doc, "a.ints").unwrap();
+		assert_eq!(ints.len, 2);
+		let mut value = 0i64;
+		assert_eq!(vtc_value_i64(&ints, 1, &mut value), VTC_OK);
+		assert_eq!(value, 2);
+		assert_eq!(vtc_value_i64(&ints, 2, &mut value), VTC_OUT_OF_RANGE);
+		let mut float = 0f64;
+		assert_eq!(vtc_value_kind(&ints, 0), vtc_kind::VTC_INT64 as i32);
+		assert_eq!(vtc_value_f64(&ints, 0, &mut float), VTC_OK);
+
+		let reference = query(doc, "a.ref").unwrap();
+		let (mut container, mut variable) = (u32::MAX, 0i32);
+		assert_eq!(vtc_value_target(&reference, 0, &mut container, &mut variable), VTC_OK);
+		assert_eq!((container, variable), (0, 0));
+		assert_eq!(vtc_value_target(&ints, 0, &mut container, &mut variable), VTC_TYPE_MISMATCH);
+
+		let (mut range, mut len) = (ptr::null(), usize::MAX);
+		assert_eq!(vtc_value_range(&reference, 0, &mut range, &mut len), VTC_OK);
+		assert_eq!(len, 0);
+		let ranged = query(doc, "a.slice").unwrap();
+		assert_eq!(vtc_value_range(&ranged, 0, &mut range, &mut len), VTC_OK);
+		assert_eq!(slice::from_raw_parts(range, len), &[0, 1]);
+		assert_eq!(vtc_value_range(&ranged, 1, &mut range, &mut len), VTC_OK);
+		assert_eq!(slice::from_raw_parts(range, len), &[1]);
+		assert_eq!(vtc_value_range(&ints, 0, &mut range, &mut len), VTC_TYPE_MISMATCH);
+		assert_eq!(vtc_value_range(&ranged, 2, &mut range, &mut len), VTC_OUT_OF_RANGE);
+
+		assert_eq!(query(doc, "a.none").unwrap().len, 0);
+		assert_eq!(query(doc, "a.missing").err(), Some(VTC_NOT_FOUND));
+		assert_eq!(query(doc, "a").err(), Some(VTC_NOT_FOUND));
+		vtc_close(doc);
+	}
+}
+
+#[test]
+fn syntax_error_is_reported() {
+	unsafe {
+		assert!(load("@a:\n\t$x := [1]\n:= [2]\n").is_null());
+		assert!(last_error().unwrap().contains("parsing"));
+
+		// A successful load clears it
+		let doc = load(DOC);
+		assert_eq!(last_error(), None);
+		vtc_close(doc);
+	}
+}
+
+#[test]
+fn open_error_is_reported() {
+	unsafe {
+		let path = CString::new("/nonexistent/vtc/doc.vtc").unwrap();
+		assert!(vtc_open(path.as_ptr()).is_null());
+		assert!(last_error().is_some());
+		assert!(vtc_open(ptr::null()).is_null());
+		assert_eq!(last_error(), Some("path is NULL"));
+	}
+}
@@ -0,0 +1,64 @@
+mod common;
+
+use std::fs;
+use std::sync::Mutex;
+use vtc::serializer::include;
+
+/// The include cache is process-wide; tests touching it run one at a time
+static CACHE: Mutex<()> = Mutex::new(());
+
+fn scratch_dir(name: &str) -> std::path::PathBuf {
+	common::scratch_dir(&format!("include-{}", name))
+}
+
+#[test]
+fn resolves_includes() {
+	let _lock = CACHE.lock().unwrap();
+	let dir = scratch_dir("graph");
+	fs::write(dir.join("root.vtc"), "%%include shared\n@root:\n\t$x := [1]\n").unwrap();
+	fs::write(dir.join("shared.vtc"), "@shared:\n\t$y := [2]\n").unwrap();
+
+	let graph = include::load(&dir.join("root.vtc"), 2).unwrap();
+	assert_eq!(graph.files.len(), 2);
+	let shared = graph.include(graph.root(), "shared").unwrap();
+	assert!(shared.parser.container("shared").is_some());
+}
+
+#[test]
+fn syntax_errors_are_not_cached() {
+	let _lock = CACHE.lock().unwrap();
+	include::cache_clear();
+	let path = scratch_dir("error").join("broken.vtc");
+	fs::write(&path, "@a:\n\t$x := [1]\n:= [2]\n").unwrap();
+
+	assert!(include::load_file(&path).is_err());
+	assert_eq!(include::cache_len(), 0);
+
+	fs::write(&path, "@a:\n\t$x := [1]\n").unwrap();
+	assert!(include::load_file(&path).is_ok());
+	assert_eq!(include::cache_len(), 1);
+}
+
+#[test]
+fn cache_is_bounded() {
+	let _lock = CACHE.lock().unwrap();
+	include::cache_clear();
+	let path = scratch_dir("bounded").join("changing.vtc");
+
+	// Rewriting a file replaces its cached parse
+	for n in 0..3 {
+		fs::write(&path, format!("@a:\n\t$x := [{}]\n", n)).unwrap();
+		include::load_file(&path).unwrap();
+	}
+	assert_eq!(include::cache_len(), 1);
+
+	let dir = scratch_dir("many");
+	for n in 0..include::MAX_CACHED + 10 {
+		let path = dir.join(format!("f{}.vtc", n));
+		fs::write(&path, format!("@f:\n\t$n := [{}]\n", n)).unwrap();
+		include::load_file(&path).unwrap();
+	}
+	assert_eq!(include::cache_len(), include::MAX_CACHED);
+	include::cache_clear();
+	assert_eq!(include::cache_len(), 0);
+}
@@ -0,0 +1,37 @@
+mod common;
+
+use common::parse;
+use vtc::key;
+use vtc::serializer::access::{hash_path, Key};
+use vtc::serializer::parser::VarType;
+
+const DOC: &str = "@a:\n\t$x := [1, 2]\n\t$y := [3]\n@b:\n\t$x := [4]\n";
+
+#[test]
+fn lookup_by_key_and_path() {
+	let parser = parse(DOC);
+	assert_eq!(parser.get_list::<i64>(key!("a.x")), Some(vec![1, 2]));
+	assert_eq!(parser.get::<i64>(key!("b.x")), Some(4));
+	assert!(matches!(parser.lookup_path("a.y"), Some(VarType::List(v)) if v.len() == 1));
+	assert!(parser.lookup_path("b.y").is_none());
+	assert!(parser.lookup_path("a").is_none());
+	assert!(parser.container("b").is_some());
+}
+
+#[test]
+fn colliding_hash_is_not_trusted() {
+	let parser = parse(DOC);
+	// A key whose hash belongs to another path behaves like a collision
+	let forged = Key { hash: hash_path("a.y"), path: "a.x" };
+	assert_eq!(parser.get_list::<i64>(forged), Some(vec![1, 2]));
+	let forged = Key { hash: hash_path("a.y"), path: "b.y" };
+	assert_eq!(parser.get::<i64>(forged), None);
+}
+
+#[test]
+fn later_definitions_win() {
+	let parser = parse("@a:\n\t$x := [1]\n\t$x := [2]\n");
+	assert_eq!(parser.get::<i64>(key!("a.x")), Some(2));
+	let forged = Key { hash: hash_path("a.z"), path: "a.x" };
+	assert_eq!(parser.get::<i64>(forged), None);
+}
@@ -0,0 +1,71 @@
+use std::mem::size_of;
+use std::sync::Mutex;
+use vtc::alloc::{self, CountingAlloc};
+use vtc::corpus::Shape;
+use vtc::serializer::explain;
+use vtc::serializer::parser::{RParser, VarType};
+use vtc::serializer::token::Tokens;
+
+#[global_allocator]
+static ALLOC: CountingAlloc = CountingAlloc;
+
+/// Tests here measure live bytes, which other threads of this binary would disturb
+static SERIAL: Mutex<()> = Mutex::new(());
+
+fn explained(data: &str) -> (RParser, explain::Report) {
+	let mut tokens = Tokens::from_text(data);
+	tokens.tokenize().unwrap();
+	let mut parser = RParser::new(tokens);
+	let report = explain::explain(&mut parser);
+	(parser, report)
+}
+
+#[test]
+fn explain_matches_memory_usage() {
+	let _serial = SERIAL.lock().unwrap();
+	let data = Shape { containers: 16, refs: 0.5, chain_depth: 2, range: 2, ..Shape::default() }.generate(3);
+	let (parser, report) = explained(&data);
+	let usage = parser.memory_usage();
+	assert_eq!(report.containers.len(), usage.containers.len());
+
+	for ((cost, memory), container) in report.containers.iter().zip(&usage.containers).zip(parser.containers()) {
+		assert_eq!(cost.heap_bytes, memory.total(), "{}", cost.name);
+		// A container owns its name, its variable slots and each variable
+		let slots = container.values.capacity() * size_of::<(String, VarType)>();
+		let vars: usize = cost.vars.iter().map(|v| v.heap_bytes).sum();
+		assert_eq!(cost.heap_bytes, container.c_name.capacity() + slots + vars, "{}", cost.name);
+	}
+}
+
+///
+/// `table_bytes` assumes SSE2's 16-byte control group; targets with 8-byte groups
+/// allocate 8 bytes less per hash index, and the parser holds a few of them
+///
+const TOLERANCE: usize = 64;
+
+///
+/// Live bytes while the parser exists match `memory_usage`. Tracing allocates
+/// per span, so this only holds without it
+///
+#[test]
+#[cfg_attr(feature = "trace", ignore)]
+fn memory_usage_matches_the_allocator() {
+	let _serial = SERIAL.lock().unwrap();
+	alloc::enable_counting();
+	for (n, shape) in [
+		Shape { containers: 4, ..Shape::default() },
+		Shape { containers: 200, refs: 0.5, chain_depth: 2, range: 2, ..Shape::default() },
+		Shape { containers: 2_000, refs: 0.2, ..Shape::default() },
+	].iter().enumerate() {
+		let data = shape.generate(n as u64);
+		let before = alloc::snapshot().current;
+		let mut tokens = Tokens::from_text(&data);
+		tokens.tokenize().unwrap();
+		let mut parser = RParser::new(tokens);
+		parser.generate_ast();
+		parser.resolve();
+		let live = alloc::snapshot().current - before;
+		let counted = parser.memory_usage().total();
+		assert!(live.abs_diff(counted) <= TOLERANCE, "shape {}: allocator {} bytes, memory_usage {}", n, live, counted);
+	}
+}
@@ -0,0 +1,36 @@
+//!
+//! Batch checking in one-shot mode, where each file is checked in an allocation
+//! region, gives the same results as with ordinary allocation.
+//!
+
+mod common;
+
+use std::fs;
+use vtc::alloc::{self, CountingAlloc};
+use vtc::batch;
+use vtc::corpus::Shape;
+
+#[global_allocator]
+static ALLOC: CountingAlloc = CountingAlloc;
+
+#[test]
+fn one_shot_batch_matches_baseline() {
+	let dir = common::scratch_dir("oneshot");
+	for n in 0..24 {
+		// A few large files spill over several bump chunks
+		let containers = if n % 12 == 11 { 5_000 } else { 50 + n * 10 };
+		let mut data = Shape { containers, refs: 0.3, chain_depth: 2, ..Shape::default() }.generate(n as u64 + 1);
+		if n % 7 == 3 { data.push_str(":= [1]\n"); }
+		if n % 5 == 1 { data.push_str("@x:\n\t$y := [&missing.z]\n"); }
+		fs::write(dir.join(format!("f{:02}.vtc", n)), data).unwrap();
+	}
+	let paths = batch::expand(&[dir.to_str().unwrap().to_string()]).unwrap();
+	let baseline = format!("{:?}", batch::check_all(&paths, &[], 2));
+	assert!(baseline.contains("error: Some"));
+
+	alloc::one_shot();
+	for jobs in [1, 2, 4] {
+		assert_eq!(format!("{:?}", batch::check_all(&paths, &[], jobs)), baseline);
+	}
+	fs::remove_dir_all(&dir).ok();
+}
@@ -0,0 +1,54 @@
+//! Each test runs on its own thread, so each starts with an empty pool
+
+use vtc::corpus;
+use vtc::key;
+use vtc::serializer::pool;
+
+#[test]
+fn second_parse_reuses_the_pooled_parser() {
+	assert_eq!(pool::idle(), 0);
+	let first = pool::parse("@a:\n\t$x := [1, 2, 3]\n").unwrap();
+	drop(first);
+	assert_eq!(pool::idle(), 1);
+
+	// A reused parser keeps its buffers; a new one starts without any
+	let reused = pool::parser();
+	assert_eq!(pool::idle(), 0);
+	assert!(reused.memory_usage().tokens > 0);
+	let fresh = pool::parser();
+	assert_eq!(fresh.memory_usage().tokens, 0);
+}
+
+#[test]
+fn reused_parser_keeps_nothing_from_the_previous_document() {
+	drop(pool::parse("@a:\n\t$x := [1]\n@b:\n\t$y := [2]\n").unwrap());
+	let doc = pool::parse("@c:\n\t$z := [3]\n").unwrap();
+	assert_eq!(pool::idle(), 0);
+	assert_eq!(doc.containers().len(), 1);
+	assert!(doc.container("a").is_none());
+	assert_eq!(doc.get::<i64>(key!("a.x")), None);
+	assert_eq!(doc.get::<i64>(key!("c.z")), Some(3));
+	drop(doc);
+
+	let empty = pool::parser();
+	assert!(empty.containers().is_empty());
+	assert!(empty.tags().is_empty());
+}
+
+#[test]
+fn large_parsers_are_not_pooled() {
+	// Well past MAX_RETAINED (1 MiB) once parsed
+	let data = corpus::generate(2 << 20, 1);
+	let doc = pool::parse(&data).unwrap();
+	assert!(doc.memory_usage().total() > 1 << 20);
+	drop(doc);
+	assert_eq!(pool::idle(), 0);
+}
+
+#[test]
+fn pool_holds_at_most_eight_parsers() {
+	let loaned: Vec<_> = (0..10).map(|n| pool::parse(&format!("@a:\n\t$x := [{}]\n", n)).unwrap()).collect();
+	assert_eq!(pool::idle(), 0);
+	drop(loaned);
+	assert_eq!(pool::idle(), 8);
+}
@@ -0,0 +1,34 @@
+mod common;
+
+use common::parse_with as parse;
+use vtc::key;
+
+const DOC: &str = "\
+%%profile prod
+@db:
+\t$host := [prod]
+%%profile dev
+@db:
+\t$host := [dev]
+%%profile all
+@app:
+\t$name := [vtc]
+";
+
+#[test]
+fn inactive_sections_are_skipped() {
+	let parser = parse(DOC, &["dev"]);
+	assert_eq!(parser.get::<&str>(key!("db.host")), Some("dev"));
+	assert_eq!(parser.containers().len(), 2);
+	assert_eq!(parser.get::<&str>(key!("app.name")), Some("vtc"));
+}
+
+#[test]
+fn section_ends_only_at_a_profile_tag() {
+	// `%%profiles` is an ordinary tag, so it stays inside the skipped section
+	let data = "%%profile prod\n@a:\n\t$x := [1]\n%%profiles x\n@b:\n\t$x := [2]\n%%profile all\n@c:\n\t$x := [3]\n";
+	let parser = parse(data, &["dev"]);
+	assert!(parser.container("a").is_none());
+	assert!(parser.container("b").is_none());
+	assert_eq!(parser.get::<i64>(key!("c.x")), Some(3));
+}
@@ -0,0 +1,44 @@
+use std::sync::{Arc, Mutex};
+use std::thread;
+use std::time::Duration;
+use vtc::serializer::reclaim::{self, Deferred};
+
+/// Records the name of the thread it is dropped on, after a delay
+struct Probe {
+	dropped_on: Arc<Mutex<Option<String>>>,
+}
+
+impl Drop for Probe {
+	fn drop(&mut self) {
+		thread::sleep(Duration::from_millis(50));
+		*self.dropped_on.lock().unwrap() = Some(thread::current().name().unwrap_or("").to_string());
+	}
+}
+
+fn probe() -> (Probe, Arc<Mutex<Option<String>>>) {
+	let dropped_on = Arc::new(Mutex::new(None));
+	(Probe { dropped_on: dropped_on.clone() }, dropped_on)
+}
+
+#[test]
+fn retired_values_drop_on_the_reclaimer() {
+	let (value, dropped_on) = probe();
+	reclaim::retire(value);
+	// The drop sleeps first, so only a flush that waits for it sees the record
+	reclaim::flush();
+	assert_eq!(dropped_on.lock().unwrap().as_deref(), Some("vtc-reclaim"));
+}
+
+#[test]
+fn deferred_values_are_retired() {
+	let (value, dropped_on) = probe();
+	drop(Deferred::new(value));
+	reclaim::flush();
+	assert_eq!(dropped_on.lock().unwrap().as_deref(), Some("vtc-reclaim"));
+
+	// Taken back, the value drops where its owner does
+	let (value, dropped_on) = probe();
+	drop(Deferred::new(value).into_inner());
+	assert_ne!(dropped_on.lock().unwrap().as_deref(), Some("vtc-reclaim"));
+	assert!(dropped_on.lock().unwrap().is_some());
+}
@@ -0,0 +1,50 @@
+//!
+//! Allocation regions in one-shot mode. A binary of its own: `one_shot` cannot be
+//! undone, and would turn every other test in the binary into a one-shot run.
+//!
+
+use vtc::alloc::{self, CountingAlloc};
+
+#[global_allocator]
+static ALLOC: CountingAlloc = CountingAlloc;
+
+/// Size of the allocator's bump chunks, as in src/alloc.rs
+const CHUNK: usize = 4 << 20;
+
+/// Allocate `count` strings of `len` bytes, all filled with `byte`
+fn fill(count: usize, len: usize, byte: u8) -> Vec<String> {
+	(0..count).map(|_| String::from_utf8(vec![byte; len]).unwrap()).collect()
+}
+
+#[test]
+fn regions_back_to_back() {
+	alloc::one_shot();
+	// Sized up front: growing them between regions would move where the next one starts
+	let mut kept: Vec<(u8, String)> = Vec::with_capacity(64);
+	let mut starts = Vec::with_capacity(64);
+	for round in 0..64u8 {
+		let byte = b'a' + round % 26;
+		// Every fourth region spills over several chunks
+		let count = if round % 4 == 3 { 3 * CHUNK / 1024 } else { 64 };
+		// SAFETY: `fill` stores nothing outside its result, and `keep` returns an owned copy
+		let copy = unsafe {
+			alloc::test_region(|| fill(count, 1000, byte), |strings| {
+				starts.push(strings[0].as_ptr() as usize);
+				assert!(strings.iter().all(|s| s.as_bytes()[0] == byte && s.as_bytes()[999] == byte));
+				strings[count - 1].clone()
+			})
+		};
+		kept.push((byte, copy));
+	}
+
+	// Copies taken out of earlier regions survive every later one
+	for (byte, copy) in &kept {
+		assert_eq!(copy.len(), 1000);
+		assert!(copy.bytes().all(|b| b == *byte));
+	}
+	// Small regions reuse the same memory; tracing turns regions off
+	if !vtc::trace::ENABLED {
+		assert_eq!(starts[0], starts[1]);
+		assert_eq!(starts[1], starts[2]);
+	}
+}
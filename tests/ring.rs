@@ -0,0 +1,139 @@
+mod common;
+
+use std::panic;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::thread;
+use std::time::Duration;
+use common::dump;
+use vtc::corpus::Shape;
+use vtc::ring;
+use vtc::serializer::parser::RParser;
+use vtc::serializer::stream;
+use vtc::serializer::token::Tokens;
+
+#[test]
+fn wraps_around_in_order() {
+	let (mut producer, mut consumer) = ring::channel::<u32>(4, 1);
+	let mut out = vec![];
+	for n in 0..100 {
+		producer.push(n).unwrap();
+		if n % 3 == 2 { assert!(consumer.pop_into(&mut out)); }
+	}
+	drop(producer);
+	while consumer.pop_into(&mut out) {}
+	assert_eq!(out, (0..100).collect::<Vec<_>>());
+}
+
+#[test]
+fn batches_are_published_whole() {
+	let (mut producer, mut consumer) = ring::channel::<u32>(16, 4);
+	for n in 0..4 { producer.push(n).unwrap(); }
+	producer.push(4).unwrap();
+	let mut out = vec![];
+	assert!(consumer.pop_into(&mut out));
+	// The fifth item waits for the next batch or an explicit publish
+	assert_eq!(out, vec![0, 1, 2, 3]);
+	producer.publish();
+	assert!(consumer.pop_into(&mut out));
+	assert_eq!(out.len(), 5);
+}
+
+#[test]
+fn empty_ring_waits_for_the_producer() {
+	let (mut producer, mut consumer) = ring::channel::<u32>(8, 8);
+	let mut out = vec![];
+	thread::scope(|scope| {
+		scope.spawn(move || {
+			thread::sleep(Duration::from_millis(20));
+			producer.push(7).unwrap();
+			// Dropping publishes the partial batch and closes the ring
+		});
+		assert!(consumer.pop_into(&mut out));
+		assert!(!consumer.pop_into(&mut out));
+	});
+	assert_eq!(out, vec![7]);
+
+	let (producer, mut consumer) = ring::channel::<u32>(8, 8);
+	drop(producer);
+	assert!(!consumer.pop_into(&mut out));
+}
+
+#[test]
+fn full_ring_blocks_until_drained() {
+	let (mut producer, mut consumer) = ring::channel::<u32>(4, 2);
+	let mut out = vec![];
+	thread::scope(|scope| {
+		scope.spawn(move || {
+			for n in 0..64 { producer.push(n).unwrap(); }
+		});
+		while consumer.pop_into(&mut out) {
+			assert!(out.len() <= 64);
+			thread::sleep(Duration::from_millis(1));
+		}
+	});
+	assert_eq!(out, (0..64).collect::<Vec<_>>());
+}
+
+#[test]
+fn push_fails_once_the_consumer_is_gone() {
+	let (mut producer, consumer) = ring::channel::<u32>(2, 1);
+	producer.push(1).unwrap();
+	producer.push(2).unwrap();
+	drop(consumer);
+	assert_eq!(producer.push(3), Err(3));
+}
+
+/// Counts drops of its values
+struct Counted(Arc<AtomicUsize>);
+
+impl Drop for Counted {
+	fn drop(&mut self) { self.0.fetch_add(1, Ordering::Relaxed); }
+}
+
+#[test]
+fn queued_items_are_dropped_with_the_ring() {
+	let drops = Arc::new(AtomicUsize::new(0));
+	let (mut producer, mut consumer) = ring::channel::<Counted>(8, 2);
+	for _ in 0..5 { assert!(producer.push(Counted(drops.clone())).is_ok()); }
+	let mut out = vec![];
+	assert!(consumer.pop_into(&mut out));
+	assert_eq!(out.len(), 4);
+	drop(out);
+	assert_eq!(drops.load(Ordering::Relaxed), 4);
+	// One item written but unpublished, then both ends gone
+	drop(consumer);
+	drop(producer);
+	assert_eq!(drops.load(Ordering::Relaxed), 5);
+}
+
+#[test]
+fn panicking_consumer_does_not_block_the_producer() {
+	let (mut producer, consumer) = ring::channel::<u32>(4, 1);
+	let result = panic::catch_unwind(panic::AssertUnwindSafe(|| thread::scope(|scope| {
+		scope.spawn(move || {
+			// Far more than the ring holds; fails once the consumer is dropped
+			for n in 0..1_000 { if producer.push(n).is_err() { break } }
+		});
+		let mut consumer = consumer;
+		let mut out = vec![];
+		consumer.pop_into(&mut out);
+		panic!("consumer failed");
+	})));
+	assert!(result.is_err());
+}
+
+#[test]
+fn overlapped_parse_matches_sequential() {
+	let valid = Shape { containers: 2_000, refs: 0.4, chain_depth: 2, ..Shape::default() }.generate(5);
+	let broken = format!("{}:= [1]\n{}", &valid[..valid.len() / 2], &valid[valid.len() / 2..]);
+	for data in [valid, broken] {
+		let mut tokens = Tokens::from_text(&data);
+		tokens.tokenize().unwrap();
+		let mut sequential = RParser::new(tokens);
+		sequential.generate_ast();
+
+		let overlapped = stream::parse(Tokens::from_text(&data)).unwrap();
+		assert_eq!(dump(&overlapped), dump(&sequential));
+	}
+}
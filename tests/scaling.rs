@@ -0,0 +1,103 @@
+//!
+//! Complexity checks: each phase is timed at doubling input sizes and fails when
+//! it grows faster than n log n. Timings are only meaningful optimized, so the
+//! checks are ignored in debug builds:
+//!     cargo test --release --test scaling
+//!
+
+use std::hint::black_box;
+use std::sync::Mutex;
+use std::time::Instant;
+use vtc::corpus;
+use vtc::serializer::compiled::{self, SourceId};
+use vtc::serializer::parser::RParser;
+use vtc::serializer::token::Tokens;
+
+const SEED: u64 = 0x5eed;
+const MIN_SIZE: usize = 64 << 10;
+const STEPS: u32 = 6;
+const RUNS: usize = 5;
+/// n log n over MIN_SIZE..MIN_SIZE << STEPS fits an exponent of ~1.07; quadratic fits 2
+const MAX_EXPONENT: f64 = 1.35;
+
+/// Checks run one at a time so they do not skew each other's timings
+static TIMING: Mutex<()> = Mutex::new(());
+
+/// Best of RUNS, in seconds; the minimum is the least noisy estimate of the cost itself
+fn time<S, T, R>(mut setup: S, mut routine: R) -> f64
+	where S: FnMut() -> T, R: FnMut(T) {
+	(0..RUNS).map(|_| {
+		let input = setup();
+		let start = Instant::now();
+		routine(input);
+		start.elapsed().as_secs_f64()
+	}).fold(f64::MAX, f64::min)
+}
+
+fn tokenized(data: &str) -> Tokens {
+	let mut tokens = Tokens::from_text(data);
+	tokens.tokenize().unwrap();
+	tokens
+}
+
+fn parsed(data: &str) -> RParser {
+	let mut parser = RParser::new(tokenized(data));
+	parser.generate_ast();
+	parser
+}
+
+/// Least-squares slope of log(time) over log(size)
+fn exponent(points: &[(f64, f64)]) -> f64 {
+	let logs: Vec<(f64, f64)> = points.iter().map(|(n, t)| (n.ln(), t.max(1e-9).ln())).collect();
+	let count = logs.len() as f64;
+	let mean_x = logs.iter().map(|p| p.0).sum::<f64>() / count;
+	let mean_y = logs.iter().map(|p| p.1).sum::<f64>() / count;
+	let cov: f64 = logs.iter().map(|(x, y)| (x - mean_x) * (y - mean_y)).sum();
+	let var: f64 = logs.iter().map(|(x, _)| (x - mean_x).powi(2)).sum();
+	cov / var
+}
+
+///
+/// Time `phase` (given each document's text) at every size and fail if it is
+/// superlinear
+///
+fn check(phase: &str, mut timed: impl FnMut(&str) -> f64) {
+	let _lock = TIMING.lock().unwrap_or_else(|e| e.into_inner());
+	let points: Vec<(f64, f64)> = (0..STEPS).map(|step| {
+		let data = corpus::generate(MIN_SIZE << step, SEED);
+		(data.len() as f64, timed(&data))
+	}).collect();
+
+	let exp = exponent(&points);
+	let per_byte: Vec<String> = points.iter().map(|(n, t)| format!("{:.1}", t * 1e9 / n)).collect();
+	println!("{:>10} {:>10.2}  ns/byte by size: {}", phase, exp, per_byte.join(" "));
+	assert!(exp <= MAX_EXPONENT, "{} is superlinear: exponent {:.2}", phase, exp);
+}
+
+#[test]
+#[cfg_attr(debug_assertions, ignore)]
+fn lex_scales() {
+	check("lex", |data| time(|| Tokens::from_text(data), |mut t| { t.tokenize().unwrap(); black_box(t); }));
+}
+
+#[test]
+#[cfg_attr(debug_assertions, ignore)]
+fn parse_scales() {
+	check("parse", |data| time(|| RParser::new(tokenized(data)), |mut p| { p.generate_ast(); black_box(p); }));
+}
+
+#[test]
+#[cfg_attr(debug_assertions, ignore)]
+fn resolve_scales() {
+	check("resolve", |data| time(|| parsed(data), |mut p| { black_box(p.resolve()); }));
+}
+
+#[test]
+#[cfg_attr(debug_assertions, ignore)]
+fn serialize_scales() {
+	check("serialize", |data| {
+		let mut resolved = parsed(data);
+		resolved.resolve();
+		time(|| (), |_| { black_box(compiled::encode(&resolved, SourceId::default(), &[])); })
+	});
+}
@@ -0,0 +1,93 @@
+use vtc::serializer::parser::RParser;
+use vtc::serializer::schema::{CompiledSchema, Schema};
+use vtc::serializer::token::Tokens;
+use vtc::serializer::types::Types;
+
+fn schema() -> CompiledSchema {
+	Schema::new()
+		.container("server")
+			.var("port", Types::U16).len(1, 1)
+			.var("hosts", Types::Str).len(1, 4)
+			.var("timeout", Types::U32).optional()
+			.var("upstream", Types::Str).refers_to("pool").optional()
+			.var("fallback", Types::Str).refers_to("server.hosts").optional()
+		.container("pool")
+			.var("size", Types::U8)
+		.compile()
+}
+
+/// Schema violations in `data`
+fn validate(data: &str, schema: &CompiledSchema) -> Vec<String> {
+	let mut tokens = Tokens::from_text(data);
+	tokens.tokenize().unwrap();
+	let mut parser = RParser::new(tokens);
+	let errors = parser.generate_ast_validated(schema);
+	assert_eq!(parser.error(), None);
+	errors.into_iter().map(|e| e.msg).collect()
+}
+
+const VALID: &str = "\
+@server:
+\t$port := [8080]
+\t$hosts := [\"a\", \"b\"]
+\t$upstream := [&pool]
+\t$fallback := [&hosts]
+@pool:
+\t$size := [4]
+";
+
+#[test]
+fn valid_document_passes() {
+	assert_eq!(validate(VALID, &schema()), Vec::<String>::new());
+}
+
+#[test]
+fn required_declarations_must_be_present() {
+	let errors = validate("@server:\n\t$hosts := [\"a\"]\n", &schema());
+	assert_eq!(errors, ["server.port: required variable is missing", "@pool: required container is missing"]);
+	// Optional variables may be left out
+	assert!(validate("@server:\n\t$port := [1]\n\t$hosts := [\"a\"]\n@pool:\n\t$size := [1]\n", &schema()).is_empty());
+}
+
+#[test]
+fn values_must_match_the_declared_type() {
+	let data = VALID.replace("[8080]", "[70000]").replace("[4]", "[\"four\"]");
+	assert_eq!(validate(&data, &schema()), [
+		"server.port: '70000' is not a valid U16",
+		"pool.size: 'four' is not a valid U8",
+	]);
+}
+
+#[test]
+fn list_length_is_bounded() {
+	let data = VALID.replace("[8080]", "[1, 2]").replace("[\"a\", \"b\"]", "[]");
+	assert_eq!(validate(&data, &schema()), [
+		"server.port: expected 1..=1 values, found 2",
+		"server.hosts: expected 1..=4 values, found 0",
+	]);
+}
+
+#[test]
+fn references_must_reach_an_allowed_target() {
+	// A single segment names a variable of the current container before a container
+	let data = VALID.replace("[&pool]", "[&port]");
+	assert_eq!(validate(&data, &schema()), ["server.upstream: reference 'port' is outside of its allowed target"]);
+
+	let data = VALID.replace("[&hosts]", "[&pool.size]");
+	assert_eq!(validate(&data, &schema()), ["server.fallback: reference 'pool.size' is outside of its allowed target"]);
+
+	let data = VALID.replace("[&pool]", "[&missing]");
+	assert_eq!(validate(&data, &schema()), ["server.upstream: reference target does not exist"]);
+
+	let data = VALID.replace("[&hosts]", "[&server.gone]");
+	assert_eq!(validate(&data, &schema()), ["server.fallback: reference target does not exist"]);
+}
+
+#[test]
+fn unknown_declarations_can_be_denied() {
+	let strict = Schema::new().deny_unknown().container("a").var("x", Types::I64).compile();
+	assert_eq!(validate("@a:\n\t$x := [1]\n\t$y := [2]\n@b:\n\t$z := [3]\n", &strict), [
+		"a.y: variable is not declared in the schema",
+		"@b: container is not declared in the schema",
+	]);
+}
@@ -0,0 +1,69 @@
+mod common;
+
+use std::fs;
+use common::{scratch_dir, write};
+use vtc::serializer::symbols::SymbolTable;
+
+#[test]
+fn lookup_loads_only_the_defining_file() {
+	let dir = scratch_dir("symbols-lookup");
+	write(&dir, "a.vtc", "@net:\n\t$port := [80]\n");
+	write(&dir, "b.vtc", "@db:\n\t$host := [\"local\"]\n");
+	let mut table = SymbolTable::new();
+	assert_eq!(table.add_dir(&dir).unwrap(), 2);
+	assert_eq!(table.loaded_count(), 0);
+	assert_eq!(table.file_of("db"), Some(dir.join("b.vtc").as_path()));
+
+	let (file, target) = table.lookup("net", "port").unwrap().unwrap();
+	assert_eq!(file.path, dir.join("a.vtc"));
+	assert_eq!((target.container, target.variable), (0, Some(0)));
+	assert_eq!(table.loaded_count(), 1);
+	// A second lookup in the same file reuses the parse
+	assert!(table.lookup("net", "").unwrap().is_some());
+	assert_eq!(table.loaded_count(), 1);
+}
+
+#[test]
+fn unknown_symbol_loads_nothing() {
+	let dir = scratch_dir("symbols-unknown");
+	write(&dir, "a.vtc", "@net:\n\t$port := [80]\n");
+	let mut table = SymbolTable::new();
+	table.add_dir(&dir).unwrap();
+	assert!(table.lookup("net", "host").unwrap().is_none());
+	assert!(table.lookup("web", "").unwrap().is_none());
+	assert!(table.file_of("web").is_none());
+	assert_eq!(table.loaded_count(), 0);
+}
+
+#[test]
+fn registering_again_replaces_symbols() {
+	let dir = scratch_dir("symbols-replace");
+	let path = write(&dir, "a.vtc", "@net:\n\t$port := [80]\n");
+	let mut table = SymbolTable::new();
+	table.add_file(&path).unwrap();
+	assert!(table.lookup("net", "port").unwrap().is_some());
+
+	fs::write(&path, "@web:\n\t$root := [\"/srv\"]\n").unwrap();
+	table.add_file(&path).unwrap();
+	assert_eq!(table.loaded_count(), 0);
+	assert!(table.file_of("net").is_none());
+	assert!(table.lookup("net", "port").unwrap().is_none());
+	let (file, _) = table.lookup("web", "root").unwrap().unwrap();
+	assert!(file.parser.container("web").is_some());
+}
+
+#[test]
+fn directory_scan_registers_only_vtc_files() {
+	let dir = scratch_dir("symbols-scan");
+	write(&dir, "a.vtc", "@net:\n\t$port := [80]\n");
+	write(&dir, "notes.txt", "@txt:\n\t$x := [1]\n");
+	write(&dir, "a.vtc.bak", "@bak:\n\t$x := [1]\n");
+	write(&dir, "sub/b.vtc", "@sub:\n\t$x := [1]\n");
+	fs::create_dir(dir.join("dir.vtc")).unwrap();
+	let mut table = SymbolTable::new();
+	assert_eq!(table.add_dir(&dir).unwrap(), 1);
+	assert!(table.file_of("net").is_some());
+	for name in ["txt", "bak", "sub"] {
+		assert!(table.file_of(name).is_none(), "{}", name);
+	}
+}